@@ -0,0 +1,127 @@
+module;
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fmt/core.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+export module bench;
+import rooster;
+
+// A tiny google-benchmark look alike: every case is timed over growing iteration counts
+// until it runs long enough, and the results can be printed as a table or as the same
+// JSON google benchmark emits, so its compare tools work on our output too.
+export namespace bench {
+
+// keeps the compiler from optimizing away a value or the writes behind it
+template<typename T> void do_not_optimize(T &value) { asm volatile("" : "+r,m"(value) : : "memory"); }
+template<typename T> void do_not_optimize(const T &value) { asm volatile("" : : "r,m"(value) : "memory"); }
+
+struct result
+{
+  std::string name;
+  std::uint64_t iterations;
+  double seconds;
+  // what the case counts per iteration, moves, playouts, nodes...
+  std::uint64_t items;
+  double ns_per_iteration() const { return seconds * 1e9 / static_cast<double>(iterations); }
+  double items_per_second() const { return static_cast<double>(items) / seconds; }
+};
+
+// usage: <bench> [--json] [--filter=<substring>] [--min-time=<seconds>]
+class runner
+{
+public:
+  runner(int argc, char *argv[])
+  {
+    for (int i = 1; i < argc; ++i) {
+      const std::string_view arg = argv[i];
+      if (arg == "--json") {
+        m_json = true;
+      } else if (arg.starts_with("--filter=")) {
+        m_filter = arg.substr(9);
+      } else if (arg.starts_with("--min-time=")) {
+        m_min_time = std::stod(std::string{ arg.substr(11) });
+      }
+    }
+  }
+
+  // body runs the case `iterations` times and returns how many items it processed
+  void run(const std::string &name, const std::function<std::uint64_t(std::uint64_t)> &body)
+  {
+    if (!m_filter.empty() && name.find(m_filter) == std::string::npos) { return; }
+    std::uint64_t iterations = 1;
+    while (true) {
+      const auto start = now();
+      const auto items = body(iterations);
+      const double seconds = std::chrono::duration<double>(now() - start).count();
+      if (seconds >= m_min_time || iterations >= max_iterations) {
+        m_results.push_back({ name, iterations, seconds, items });
+        if (!m_json) { print_row(m_results.back()); }
+        return;
+      }
+      // aim a little past the minimum time, but never grow more than 10x at once
+      const double scale = seconds > 0 ? 1.4 * m_min_time / seconds : 10.0;
+      iterations = static_cast<std::uint64_t>(static_cast<double>(iterations) * (scale < 10.0 ? scale : 10.0)) + 1;
+    }
+  }
+
+  const std::vector<result> &results() const { return m_results; }
+  // extra human readable output should be skipped when this is true
+  bool json() const { return m_json; }
+
+  void report() const
+  {
+    if (!m_json) { return; }
+    const auto date = std::time(nullptr);
+    char date_text[32];
+    std::strftime(date_text, sizeof(date_text), "%Y-%m-%dT%H:%M:%S", std::localtime(&date));
+    fmt::print("{{\n  \"context\": {{\n    \"date\": \"{}\",\n    \"num_cpus\": {},\n    \"library_build_type\": \"{}\"\n  }},\n",
+      date_text,
+      std::thread::hardware_concurrency(),
+#ifdef NDEBUG
+      "release"
+#else
+      "debug"
+#endif
+    );
+    fmt::print("  \"benchmarks\": [\n");
+    for (std::size_t i = 0; i < m_results.size(); ++i) {
+      const auto &r = m_results[i];
+      fmt::print(
+        "    {{\n      \"name\": \"{}\",\n      \"run_type\": \"iteration\",\n      \"iterations\": {},\n      \"real_time\": "
+        "{:.3f},\n      \"cpu_time\": {:.3f},\n      \"time_unit\": \"ns\",\n      \"items_per_second\": {:.1f}\n    }}{}\n",
+        r.name,
+        r.iterations,
+        r.ns_per_iteration(),
+        r.ns_per_iteration(),
+        r.items_per_second(),
+        i + 1 < m_results.size() ? "," : "");
+    }
+    fmt::print("  ]\n}}\n");
+  }
+
+private:
+  constexpr static std::uint64_t max_iterations = 1'000'000'000;
+
+  static void print_row(const result &r)
+  {
+    fmt::print("{:<40} {:>12.2f} ns {:>14} {:>14.0f} items/s\n",
+      r.name,
+      r.ns_per_iteration(),
+      r.iterations,
+      r.items_per_second());
+    std::fflush(stdout);
+  }
+
+  bool m_json = false;
+  std::string m_filter;
+  double m_min_time = 0.5;
+  std::vector<result> m_results;
+};
+
+}// namespace bench
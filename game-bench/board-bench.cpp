@@ -0,0 +1,149 @@
+import board;
+import bench;
+import evaluation;
+import solver;
+import transposition_table;
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// xorshift, the benchmarks should measure the board and not the random number generator
+struct fast_random
+{
+  std::uint64_t state;
+  std::uint64_t next()
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+};
+
+// a position with `plies` pieces where nobody has won yet, the same on every run
+board make_position(std::uint8_t plies)
+{
+  fast_random random{ 0x2545'f491'4f6c'dd1d };
+  while (true) {
+    board b;
+    while (b.moves_played() < plies) {
+      const auto moves = b.legal_moves();
+      const auto column = moves.moves[random.next() % moves.size];
+      const auto row = b.play(column);
+      if (b.check_winner_at(*row, column)) { break; }
+    }
+    if (b.moves_played() == plies && !b.check_winner(piece::red) && !b.check_winner(piece::yellow)) { return b; }
+  }
+}
+
+// plays random moves until the game ends, then takes them all back
+int playout(board &b, fast_random &random)
+{
+  const auto start = b.move_stack_size;
+  int result = 0;
+  while (b.moves_played() < board::cells) {
+    const auto moves = b.legal_moves();
+    const auto column = moves.moves[random.next() % moves.size];
+    const auto row = b.play(column);
+    if (b.check_winner_at(*row, column)) {
+      result = b.to_move() == piece::red ? -1 : 1;
+      break;
+    }
+  }
+  while (b.move_stack_size > start) { b.undo(); }
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  bench::runner runner(argc, argv);
+  const std::array<std::pair<std::string, board>, 3> positions{ {
+    { "empty", board{} },
+    { "midgame", make_position(20) },
+    { "nearfull", make_position(36) },
+  } };
+
+  for (const auto &[name, position] : positions) {
+    runner.run("put_piece/" + name, [&](std::uint64_t iterations) {
+      auto b = position;
+      const auto moves = b.legal_moves();
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        const auto column = moves.moves[i % moves.size];
+        b.put_piece(piece::red, column);
+        b.remove_piece(column);
+        bench::do_not_optimize(b);
+      }
+      return iterations;
+    });
+    runner.run("check_winner/" + name, [&](std::uint64_t iterations) {
+      auto b = position;
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        bench::do_not_optimize(b);
+        bench::do_not_optimize(b.check_winner(piece::red));
+      }
+      return iterations;
+    });
+    runner.run("check_winner_at/" + name, [&](std::uint64_t iterations) {
+      auto b = position;
+      const auto moves = b.legal_moves();
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        const auto column = moves.moves[i % moves.size];
+        const auto row = b.put_piece(piece::red, column);
+        bench::do_not_optimize(b.check_winner_at(*row, column));
+        b.remove_piece(column);
+      }
+      return iterations;
+    });
+    // includes copying the position back in, otherwise every reset after the first clears an empty board
+    runner.run("reset/" + name, [&](std::uint64_t iterations) {
+      auto b = position;
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        b = position;
+        bench::do_not_optimize(b);
+        b.reset();
+        bench::do_not_optimize(b);
+      }
+      return iterations;
+    });
+    runner.run("evaluate/" + name, [&](std::uint64_t iterations) {
+      auto b = position;
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        bench::do_not_optimize(b);
+        bench::do_not_optimize(evaluate_threats(b));
+      }
+      return iterations;
+    });
+    runner.run("evaluate_reference/" + name, [&](std::uint64_t iterations) {
+      auto b = position;
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        bench::do_not_optimize(b);
+        bench::do_not_optimize(evaluate_threats_reference(b));
+      }
+      return iterations;
+    });
+    runner.run("playout/" + name, [&](std::uint64_t iterations) {
+      auto b = position;
+      fast_random random{ 0x9e37'79b9'7f4a'7c15 };
+      int total = 0;
+      for (std::uint64_t i = 0; i < iterations; ++i) { total += playout(b, random); }
+      bench::do_not_optimize(total);
+      return iterations;
+    });
+  }
+
+  // the solver on top of the board, items are nodes
+  const auto endgame = make_position(26);
+  transposition_table table(16);
+  runner.run("solve/endgame", [&](std::uint64_t iterations) {
+    solver s(0, &table);
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      table.clear();
+      bench::do_not_optimize(s.solve(endgame).score);
+    }
+    return s.nodes();
+  });
+
+  runner.report();
+  return 0;
+}
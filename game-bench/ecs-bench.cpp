@@ -0,0 +1,214 @@
+import bench;
+import ginseng;
+#include <cstdint>
+#include <fmt/core.h>
+#include <string>
+#include <vector>
+
+struct position
+{
+  float x, y;
+};
+struct velocity
+{
+  float x, y;
+};
+struct health
+{
+  int points;
+};
+using frozen = ginseng::tag<struct frozen_tag>;
+
+constexpr int entity_count = 100'000;
+
+// xorshift, the benchmarks should measure the registry and not the random number generator
+struct fast_random
+{
+  std::uint64_t state;
+  std::uint64_t next()
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+};
+
+// every entity has a position, most move, half have health, a third are frozen, so the
+// visits below see a handful of different component sets mixed together
+template<typename Database> std::vector<typename Database::ent_id> populate(Database &db)
+{
+  fast_random random{ 0x2545'f491'4f6c'dd1d };
+  std::vector<typename Database::ent_id> ids;
+  for (int i = 0; i < entity_count; ++i) {
+    const auto id = db.create_entity();
+    db.add_component(id, position{ 0, 0 });
+    if (random.next() % 4 != 0) { db.add_component(id, velocity{ 1, 1 }); }
+    if (random.next() % 2 == 0) { db.add_component(id, health{ 100 }); }
+    if (random.next() % 3 == 0) { db.add_component(id, frozen{}); }
+    ids.push_back(id);
+  }
+  return ids;
+}
+
+template<typename Database> void run_cases(bench::runner &runner, const std::string &kind)
+{
+  Database db;
+  auto ids = populate(db);
+
+  runner.run("visit/1_component/" + kind, [&](std::uint64_t iterations) {
+    std::uint64_t visited = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      db.visit([&](position &p) {
+        p.x += 1;
+        ++visited;
+      });
+    }
+    return visited;
+  });
+  runner.run("visit/3_components/" + kind, [&](std::uint64_t iterations) {
+    std::uint64_t visited = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      db.visit([&](position &p, const velocity &v, const health &h) {
+        p.x += v.x * static_cast<float>(h.points);
+        p.y += v.y;
+        ++visited;
+      });
+    }
+    return visited;
+  });
+  runner.run("visit/deny_tag/" + kind, [&](std::uint64_t iterations) {
+    std::uint64_t visited = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      db.visit([&](position &p, const velocity &v, ginseng::deny<frozen>) {
+        p.x += v.x;
+        ++visited;
+      });
+    }
+    return visited;
+  });
+  // a component added and removed again, what the archetype storage pays for its visits
+  runner.run("add_remove/" + kind, [&](std::uint64_t iterations) {
+    fast_random random{ 0x9e37'79b9'7f4a'7c15 };
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      const auto id = ids[random.next() % ids.size()];
+      if (db.template has_component<health>(id)) {
+        db.template remove_component<health>(id);
+      } else {
+        db.add_component(id, health{ 100 });
+      }
+    }
+    return iterations;
+  });
+}
+
+// the same visits through cached queries, and what keeping a query up to date adds to churn
+void run_query_cases(bench::runner &runner)
+{
+  ginseng::database db;
+  auto ids = populate(db);
+  auto &moving = db.get_query<position, velocity, health>();
+  auto &thawed = db.get_query<position, velocity, ginseng::deny<frozen>>();
+
+  runner.run("visit_query/3_components/database", [&](std::uint64_t iterations) {
+    std::uint64_t visited = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      db.visit(moving, [&](position &p, const velocity &v, const health &h) {
+        p.x += v.x * static_cast<float>(h.points);
+        p.y += v.y;
+        ++visited;
+      });
+    }
+    return visited;
+  });
+  runner.run("visit_query/deny_tag/database", [&](std::uint64_t iterations) {
+    std::uint64_t visited = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      db.visit(thawed, [&](position &p, const velocity &v, ginseng::deny<frozen>) {
+        p.x += v.x;
+        ++visited;
+      });
+    }
+    return visited;
+  });
+  runner.run("add_remove_query/database", [&](std::uint64_t iterations) {
+    fast_random random{ 0x9e37'79b9'7f4a'7c15 };
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      const auto id = ids[random.next() % ids.size()];
+      if (db.has_component<health>(id)) {
+        db.remove_component<health>(id);
+      } else {
+        db.add_component(id, health{ 100 });
+      }
+    }
+    return iterations;
+  });
+}
+
+// most entities destroyed again, visited with the holes they leave and after compacting them away
+void run_compact_cases(bench::runner &runner)
+{
+  ginseng::database db;
+  auto ids = populate(db);
+  fast_random random{ 0x9e37'79b9'7f4a'7c15 };
+  for (const auto id : ids) {
+    if (random.next() % 10 != 0) { db.destroy_entity(id); }
+  }
+
+  const auto visit_case = [&](const std::string &name) {
+    runner.run(name, [&](std::uint64_t iterations) {
+      std::uint64_t visited = 0;
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        db.visit([&](position &p, const velocity &v) {
+          p.x += v.x;
+          ++visited;
+        });
+      }
+      return visited;
+    });
+  };
+  visit_case("visit/after_churn/database");
+  const auto before = db.get_fragmentation<position>();
+  db.compact();
+  visit_case("visit/after_compact/database");
+  if (!runner.json()) {
+    fmt::print("  position fragmentation {:.0f}% over {} slots before compacting\n", 100.0 * before.fragmentation(), before.slots);
+  }
+}
+
+// the three component visit again, split over the default pool
+void run_parallel_cases(bench::runner &runner)
+{
+  ginseng::database db;
+  populate(db);
+  std::uint64_t matches = 0;
+  db.visit([&](ginseng::require<position>, ginseng::require<velocity>, ginseng::require<health>) { ++matches; });
+
+  for (const auto grain : { 1024, 8192 }) {
+    runner.run(fmt::format("visit_parallel/3_components/grain:{}/threads:{}", grain, ginseng::default_thread_pool().size() + 1),
+      [&](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+          db.visit_parallel<position>(
+            [](position &p, const velocity &v, const health &h) {
+              p.x += v.x * static_cast<float>(h.points);
+              p.y += v.y;
+            },
+            grain);
+        }
+        return iterations * matches;
+      });
+  }
+}
+
+// items are entities visited, or components added and removed
+int main(int argc, char *argv[])
+{
+  bench::runner runner(argc, argv);
+  run_cases<ginseng::database>(runner, "database");
+  run_cases<ginseng::archetype_database>(runner, "archetype");
+  run_query_cases(runner);
+  run_compact_cases(runner);
+  run_parallel_cases(runner);
+  runner.report();
+  return 0;
+}
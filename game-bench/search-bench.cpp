@@ -0,0 +1,85 @@
+import board;
+import bench;
+import mcts;
+import search;
+import transposition_table;
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fmt/core.h>
+#include <string>
+#include <string_view>
+
+// openings the searcher cannot see through at the benchmark depth, as 1-based columns
+constexpr std::array<std::string_view, 4> hard_positions{ "4453", "44444", "3344556", "4433221" };
+constexpr std::uint8_t depth = 13;
+constexpr std::array<std::uint8_t, 7> thread_counts{ 1, 2, 4, 8, 16, 32, 64 };
+constexpr std::uint64_t playouts = 100'000;
+
+board from_moves(std::string_view moves)
+{
+  board b;
+  for (const auto move : moves) { b.play(static_cast<std::uint8_t>(move - '1')); }
+  return b;
+}
+
+std::string lazy_smp_name(const std::uint8_t threads)
+{
+  return fmt::format("lazy_smp/depth:{}/threads:{}", depth, threads);
+}
+std::string mcts_name(const std::uint8_t threads)
+{
+  return fmt::format("mcts/playouts:{}/threads:{}", playouts, threads);
+}
+
+// time to depth over all the hard positions and time for a fixed number of mcts playouts from
+// the empty board, for 1 to 64 threads, the speedup is against 1 thread of the same kind
+int main(int argc, char *argv[])
+{
+  bench::runner runner(argc, argv);
+  transposition_table table(64);
+  searcher search(table);
+
+  for (const auto threads : thread_counts) {
+    runner.run(lazy_smp_name(threads), [&](std::uint64_t iterations) {
+      std::uint64_t nodes = 0;
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        for (const auto moves : hard_positions) {
+          table.clear();
+          nodes += search.search(from_moves(moves), { 1'000'000, depth, threads }).nodes;
+        }
+      }
+      return nodes;
+    });
+  }
+
+  mcts tree(64);
+  for (const auto threads : thread_counts) {
+    runner.run(mcts_name(threads), [&](std::uint64_t iterations) {
+      std::uint64_t done = 0;
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        const auto report = tree.search(board{}, { 1'000'000, playouts, threads });
+        bench::do_not_optimize(report.best_move);
+        done += report.playouts;
+      }
+      return done;
+    });
+  }
+
+  // a --filter can leave out a single thread run, its kind has nothing to compare against then
+  const auto &results = runner.results();
+  auto find = [&](const std::string &name) {
+    return std::find_if(results.begin(), results.end(), [&](const auto &result) { return result.name == name; });
+  };
+  const auto lazy_smp_single = find(lazy_smp_name(1));
+  const auto mcts_single = find(mcts_name(1));
+  if (!runner.json()) {
+    for (const auto &result : results) {
+      const auto single = result.name.starts_with("lazy_smp/") ? lazy_smp_single : mcts_single;
+      if (single == results.end()) { continue; }
+      fmt::print("{:<40} speedup {:.2f}x\n", result.name, single->ns_per_iteration() / result.ns_per_iteration());
+    }
+  }
+  runner.report();
+  return 0;
+}
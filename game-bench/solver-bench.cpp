@@ -0,0 +1,75 @@
+import board;
+import bench;
+import parallel_solver;
+import transposition_table;
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fmt/core.h>
+#include <string>
+#include <string_view>
+
+// endgames the serial solver needs a fraction of a second to a few seconds for, as 1-based columns
+constexpr std::array<std::string_view, 2> endgames{ "334455667711223366", "445544332277116611" };
+constexpr std::array<std::uint8_t, 7> thread_counts{ 1, 2, 4, 8, 16, 32, 64 };
+
+board from_moves(std::string_view moves)
+{
+  board b;
+  for (const auto move : moves) { b.play(static_cast<std::uint8_t>(move - '1')); }
+  return b;
+}
+
+std::string run_name(const std::uint8_t threads) { return fmt::format("work_stealing/threads:{}", threads); }
+
+// time to solve all the endgames for 1 to 64 threads, the speedup is against 1 thread
+int main(int argc, char *argv[])
+{
+  bench::runner runner(argc, argv);
+  transposition_table table(64);
+
+  for (const auto threads : thread_counts) {
+    parallel_solver solver(table, threads);
+    const auto name = run_name(threads);
+    runner.run(name, [&](std::uint64_t iterations) {
+      solver.reset_stats();
+      for (std::uint64_t i = 0; i < iterations; ++i) {
+        for (const auto moves : endgames) {
+          table.clear();
+          bench::do_not_optimize(solver.solve(from_moves(moves)).score);
+        }
+      }
+      return solver.nodes();
+    });
+    if (runner.json() || runner.results().empty() || runner.results().back().name != name) { continue; }
+    // the last timing run only, summed over the threads
+    worker_stats total{};
+    for (const auto &stats : solver.stats()) {
+      total.tasks += stats.tasks;
+      total.steals += stats.steals;
+      total.failed_steals += stats.failed_steals;
+      total.idle_seconds += stats.idle_seconds;
+      total.table += stats.table;
+    }
+    const auto &result = runner.results().back();
+    const auto probes = total.table.hits + total.table.misses + total.table.collisions;
+    fmt::print("  tasks {} steals {} failed steals {} idle {:.1f}% table hits {:.1f}%\n",
+      total.tasks,
+      total.steals,
+      total.failed_steals,
+      100.0 * total.idle_seconds / (result.seconds * threads),
+      probes > 0 ? 100.0 * static_cast<double>(total.table.hits) / static_cast<double>(probes) : 0.0);
+  }
+
+  // a --filter can leave out the single thread run, there is nothing to compare against then
+  const auto &results = runner.results();
+  const auto single = std::find_if(
+    results.begin(), results.end(), [](const auto &result) { return result.name == run_name(1); });
+  if (!runner.json() && single != results.end()) {
+    for (const auto &result : results) {
+      fmt::print("{:<40} speedup {:.2f}x\n", result.name, single->ns_per_iteration() / result.ns_per_iteration());
+    }
+  }
+  runner.report();
+  return 0;
+}
@@ -0,0 +1,82 @@
+import ai_player;
+import board;
+#include <boost/ut.hpp>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+board from_moves(std::string_view moves)
+{
+  board b;
+  for (const auto move : moves) { b.play(static_cast<std::uint8_t>(move - '1')); }
+  return b;
+}
+
+// polls like the main loop does every frame, nullopt when nothing came within the timeout
+std::optional<std::uint8_t> wait_for_move(ai_player &ai, std::chrono::milliseconds timeout)
+{
+  const auto give_up = std::chrono::steady_clock::now() + timeout;
+  while (std::chrono::steady_clock::now() < give_up) {
+    if (const auto move = ai.poll()) { return move; }
+    std::this_thread::sleep_for(1ms);
+  }
+  return std::nullopt;
+}
+
+boost::ut::suite ai_player_tests = [] {
+  using namespace boost::ut;
+
+  "start answers with a legal move"_test = [] {
+    for (const auto moves : { "", "4444", "1122334" }) {
+      const auto position = from_moves(moves);
+      ai_player ai(50);
+      ai.start(position);
+      const auto move = wait_for_move(ai, 10s);
+      expect(move.has_value() && position.can_play(*move)) << "after " << moves;
+      expect(!ai.poll().has_value()) << "one answer per start";
+    }
+  };
+
+  "cancel throws the answer away"_test = [] {
+    const auto position = from_moves("4453");
+    {
+      // still searching when cancelled
+      ai_player ai(60'000);
+      ai.start(position);
+      ai.cancel();
+      expect(!ai.poll().has_value());
+    }
+    {
+      // done and already pushed when cancelled
+      ai_player ai(1);
+      ai.start(position);
+      std::this_thread::sleep_for(500ms);
+      ai.cancel();
+      expect(!ai.poll().has_value());
+    }
+  };
+
+  "a pondered reply is answered without a search"_test = [] {
+    // the human to move; each reply gets 50 ms, far less than the wait below
+    const auto position = from_moves("4455");
+    constexpr std::uint8_t hovered = 2;
+    ai_player ai(50);
+    ai.ponder(position, hovered);
+    std::this_thread::sleep_for(2s);
+
+    auto reply = position;
+    reply.play(hovered);
+    ai.start(reply);
+    // a search would take its 50 ms, an answer kept by the ponder is there at once
+    const auto move = ai.poll();
+    expect(move.has_value() && reply.can_play(*move));
+  };
+};
+
+}// namespace
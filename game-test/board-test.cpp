@@ -0,0 +1,83 @@
+import board;
+#include <boost/ut.hpp>
+#include <cstdint>
+#include <string_view>
+
+namespace {
+
+// 1-based columns, the same notation as the benchmarks
+template<typename Board> Board from_moves(std::string_view moves)
+{
+  Board b;
+  for (const auto move : moves) { b.play(static_cast<std::uint8_t>(move - '1')); }
+  return b;
+}
+
+// true when the last move of the sequence wins, checked both through its lines and the whole board
+template<typename Board> bool last_move_wins(std::string_view moves)
+{
+  auto b = from_moves<Board>(moves.substr(0, moves.size() - 1));
+  const auto mover = b.to_move();
+  const auto row = b.play(static_cast<std::uint8_t>(moves.back() - '1'));
+  const bool at = b.check_winner_at(*row, static_cast<std::uint8_t>(moves.back() - '1'));
+  return at && b.check_winner(mover);
+}
+
+boost::ut::suite board_tests = [] {
+  using namespace boost::ut;
+
+  "standard board wins"_test = [] {
+    // horizontal, vertical and both diagonals for red
+    expect(last_move_wins<board>("1122334"));
+    expect(last_move_wins<board>("1212121"));
+    expect(last_move_wins<board>("12233434454"));
+    expect(last_move_wins<board>("76655454434"));
+    expect(!last_move_wins<board>("112233"));
+  };
+
+  "wide board, 7 rows by 9 columns"_test = [] {
+    using wide = basic_board<7, 9, 4>;
+    // the last columns sit above bit 64 of the masks
+    expect(last_move_wins<wide>("9988776"));
+    expect(last_move_wins<wide>("9898989"));
+    expect(last_move_wins<wide>("98877676656"));
+    expect(!last_move_wins<wide>("99887"));
+    auto b = from_moves<wide>("9999999");
+    expect(!b.can_play(8));
+    expect(b.legal_moves().size == 8);
+  };
+
+  "connect 5 on 9 rows by 7 columns"_test = [] {
+    using tall = basic_board<9, 7, 5>;
+    expect(!last_move_wins<tall>("1122334"));
+    expect(last_move_wins<tall>("112233445"));
+    expect(!last_move_wins<tall>("1212121"));
+    expect(last_move_wins<tall>("121212121"));
+    auto b = from_moves<tall>("777777777");
+    expect(!b.can_play(6));
+    expect(b.moves_played() == 9);
+  };
+
+  "hashes follow play and undo on every size"_test = [] {
+    const auto check = []<typename Board>(std::string_view moves, std::string_view mirrored) {
+      auto b = from_moves<Board>(moves);
+      const auto key = b.key();
+      const auto hash = b.hash();
+      b.play(0);
+      b.undo();
+      expect(b.key() == key && b.hash() == hash);
+      // a position and its mirror share the canonical keys
+      const auto m = from_moves<Board>(mirrored);
+      expect(b.symmetric_key() == m.symmetric_key());
+      expect(b.canonical_key() == m.canonical_key());
+      expect(b.hash() != m.hash());
+      while (b.moves_played() > 0) { b.undo(); }
+      expect(b.hash() == 0 && b.key() == Board{}.key());
+    };
+    check.operator()<board>("4435", "4453");
+    check.operator()<basic_board<7, 9, 4>>("5519", "5591");
+    check.operator()<basic_board<9, 7, 5>>("4412", "4476");
+  };
+};
+
+}// namespace
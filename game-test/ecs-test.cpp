@@ -0,0 +1,445 @@
+import ginseng;
+#include <algorithm>
+#include <atomic>
+#include <boost/ut.hpp>
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct position
+{
+  std::int64_t x, y;
+};
+struct velocity
+{
+  std::int64_t x, y;
+};
+struct health
+{
+  std::int64_t points;
+};
+using frozen = ginseng::tag<struct frozen_tag>;
+
+using ent_id = ginseng::database::ent_id;
+
+// entities with a random mix of components, some destroyed again so the slots have holes
+std::vector<ent_id> populate(ginseng::database &db, int count, unsigned seed)
+{
+  std::mt19937 random(seed);
+  std::vector<ent_id> ids;
+  for (int i = 0; i < count; ++i) {
+    const auto id = db.create_entity();
+    db.add_component(id, position{ i, 0 });
+    if (random() % 4 != 0) { db.add_component(id, velocity{ 1, 2 }); }
+    if (random() % 2 == 0) { db.add_component(id, health{ 3 }); }
+    if (random() % 3 == 0) { db.add_component(id, frozen{}); }
+    if (random() % 7 == 0) {
+      db.destroy_entity(id);
+    } else {
+      ids.push_back(id);
+    }
+  }
+  return ids;
+}
+
+// every entity's position, in creation order
+std::vector<position> positions(ginseng::database &db, const std::vector<ent_id> &ids)
+{
+  std::vector<position> result;
+  for (const auto id : ids) { result.push_back(db.get_component<position>(id)); }
+  return result;
+}
+
+bool operator==(const position &a, const position &b) { return a.x == b.x && a.y == b.y; }
+bool operator==(const velocity &a, const velocity &b) { return a.x == b.x && a.y == b.y; }
+
+// the entities a visitor taking ent_id and Components... goes through, sorted
+template<typename... Components, typename... Query>
+std::vector<ent_id::index_type> matches(ginseng::database &db, const ginseng::query<Query...> *q = nullptr)
+{
+  std::vector<ent_id::index_type> result;
+  auto collect = [&](ent_id id, Components...) { result.push_back(id.get_index()); };
+  if (q) {
+    db.visit(*q, collect);
+  } else {
+    db.visit(collect);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// over-aligned, so an archetype's columns cannot all start right after the entity ids
+struct alignas(32) wide
+{
+  std::int64_t value;
+};
+
+// counts its live copies, a component destroyed twice or never shows up in the count
+struct tracked
+{
+  tracked(int *counter, std::int64_t initial) : live(counter), value(initial) { ++*live; }
+  tracked(const tracked &other) : live(other.live), value(other.value) { ++*live; }
+  tracked &operator=(const tracked &other) = default;
+  ~tracked() { --*live; }
+  int *live;
+  std::int64_t value;
+};
+
+// one entity as a lookup or a visit saw it, by its place in the churn; -1 for a missing component
+struct seen
+{
+  std::size_t slot;
+  std::int64_t pos, vel, wide_value, tracked_value;
+  bool is_frozen;
+  auto operator<=>(const seen &) const = default;
+};
+
+template<typename T> std::int64_t value_of(const T *com)
+{
+  if (!com) { return -1; }
+  if constexpr (requires { com->x; }) {
+    return com->x;
+  } else {
+    return com->value;
+  }
+}
+
+// every entity through get_component and has_component, which must agree with each other
+template<typename Database> std::vector<seen> lookups(Database &db, const std::vector<typename Database::ent_id> &ids)
+{
+  std::vector<seen> result;
+  for (std::size_t slot = 0; slot < ids.size(); ++slot) {
+    const auto id = ids[slot];
+    const seen entity{ slot,
+      value_of(db.template get_component<position *>(id)),
+      value_of(db.template get_component<velocity *>(id)),
+      value_of(db.template get_component<wide *>(id)),
+      value_of(db.template get_component<tracked *>(id)),
+      db.template has_component<frozen>(id) };
+    const bool consistent = db.exists(id) && (entity.pos != -1) == db.template has_component<position>(id)
+                            && (entity.vel != -1) == db.template has_component<velocity>(id)
+                            && (entity.wide_value != -1) == db.template has_component<wide>(id)
+                            && (entity.tracked_value != -1) == db.template has_component<tracked>(id);
+    result.push_back(consistent ? entity : seen{ slot, -2, -2, -2, -2, false });
+  }
+  return result;
+}
+
+// a few visits with optional, deny, tag and ent_id parameters, each sorted by slot
+template<typename Database>
+std::vector<std::vector<seen>> visits(Database &db, const std::vector<typename Database::ent_id> &ids, bool &aligned)
+{
+  using id_type = typename Database::ent_id;
+  std::unordered_map<typename id_type::index_type, std::size_t> slots;
+  for (std::size_t slot = 0; slot < ids.size(); ++slot) { slots.emplace(ids[slot].get_index(), slot); }
+
+  std::vector<std::vector<seen>> result(3);
+  db.visit([&](id_type id, const position &p, ginseng::optional<velocity> v, ginseng::deny<frozen>) {
+    result[0].push_back({ slots.at(id.get_index()), p.x, v ? v->x : -1, -1, -1, false });
+  });
+  db.visit([&](id_type id, const wide &w, const tracked &t, ginseng::optional<frozen> f) {
+    aligned = aligned && reinterpret_cast<std::uintptr_t>(&w) % alignof(wide) == 0;
+    result[1].push_back({ slots.at(id.get_index()), -1, -1, w.value, t.value, static_cast<bool>(f) });
+  });
+  db.visit([&](id_type id, frozen, ginseng::optional<tracked> t) {
+    result[2].push_back({ slots.at(id.get_index()), -1, -1, -1, t ? t->value : -1, true });
+  });
+  for (auto &entities : result) { std::sort(entities.begin(), entities.end()); }
+  return result;
+}
+
+boost::ut::suite ecs_tests = [] {
+  using namespace boost::ut;
+
+  "visit_parallel does what visit does"_test = [] {
+    // more workers than this machine may have cores, the visit must not depend on it
+    ginseng::thread_pool pool(3);
+    for (const std::size_t grain : { 0u, 1u, 7u, 4096u }) {
+      ginseng::database serial;
+      ginseng::database parallel;
+      const auto serial_ids = populate(serial, 20'000, 5);
+      const auto parallel_ids = populate(parallel, 20'000, 5);
+
+      serial.visit([](position &p, const velocity &v, ginseng::deny<frozen>) {
+        p.x += v.x;
+        p.y += v.y;
+      });
+      parallel.visit_parallel<position>(
+        [](position &p, const velocity &v, ginseng::deny<frozen>) {
+          p.x += v.x;
+          p.y += v.y;
+        },
+        grain,
+        pool);
+      serial.visit([](position &p, ginseng::optional<health> h) { p.x *= h ? h->points : 2; });
+      // optional gives write access, so health counts as written
+      parallel.visit_parallel<position, health>(
+        [](position &p, ginseng::optional<health> h) { p.x *= h ? h->points : 2; }, grain, pool);
+      expect(positions(serial, serial_ids) == positions(parallel, parallel_ids)) << "grain " << grain;
+
+      // visitors without a component to split by go over the entities, each exactly once
+      std::atomic<std::size_t> visited = 0;
+      parallel.visit_parallel([&](ent_id) { visited.fetch_add(1, std::memory_order_relaxed); }, grain, pool);
+      expect(visited.load() == parallel.size());
+    }
+  };
+
+  "visit_parallel from inside a job of the same pool"_test = [] {
+    ginseng::thread_pool pool(2);
+    ginseng::database db;
+    populate(db, 5'000, 7);
+    std::int64_t expected = 0;
+    db.visit([&](const position &p) { expected += p.x; });
+    std::atomic<std::int64_t> sum = 0;
+    pool.run(6, [&](std::size_t) {
+      db.visit_parallel([&](const position &p) { sum.fetch_add(p.x, std::memory_order_relaxed); }, 256, pool);
+    });
+    expect(sum.load() == 6 * expected);
+  };
+
+  "queries match what a plain visit matches"_test = [] {
+    ginseng::database db;
+    // made before any entity exists, updated as they come and go
+    const auto &early = db.get_query<ent_id, position, velocity, ginseng::deny<frozen>>();
+    auto ids = populate(db, 2'000, 11);
+    const auto &late = db.get_query<ent_id, position, velocity, ginseng::deny<frozen>>();
+    expect(&early == &late) << "the same parameters must give the same query";
+    const auto &tagged = db.get_query<ent_id, frozen, ginseng::optional<health>>();
+
+    auto check = [&](const char *step) {
+      const auto expected = matches<const position &, const velocity &, ginseng::deny<frozen>>(db);
+      expect(matches<const position &, const velocity &, ginseng::deny<frozen>>(db, &late) == expected) << step;
+      expect(late.size() == expected.size()) << step;
+      const auto expected_tagged = matches<frozen, ginseng::optional<health>>(db);
+      expect(matches<frozen, ginseng::optional<health>>(db, &tagged) == expected_tagged) << step;
+    };
+    check("populated");
+
+    std::mt19937 random(3);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+      const auto id = ids[i];
+      switch (random() % 5) {
+      case 0: db.add_component(id, velocity{ 0, 1 }); break;
+      // removing a component the entity does not have is not allowed
+      case 1:
+        if (db.has_component<velocity>(id)) { db.remove_component<velocity>(id); }
+        break;
+      case 2: db.add_component(id, frozen{}); break;
+      case 3: db.remove_component<frozen>(id); break;
+      default: break;
+      }
+    }
+    check("components added and removed");
+    expect(db.count<velocity>() == matches<const velocity &>(db).size());
+
+    for (std::size_t i = 0; i < ids.size(); i += 3) { db.destroy_entity(ids[i]); }
+    check("entities destroyed");
+
+    // new entities reuse the destroyed slots
+    for (int i = 0; i < 500; ++i) {
+      const auto id = db.create_entity();
+      db.add_component(id, position{ i, i });
+      if (i % 2 == 0) { db.add_component(id, velocity{ 1, 1 }); }
+      if (i % 5 == 0) { db.add_component(id, frozen{}); }
+    }
+    check("entities created again");
+  };
+
+  "queries do not take component guids"_test = [] {
+    struct first_after_queries
+    {
+      int value;
+    };
+    struct second_after_queries
+    {
+      int value;
+    };
+    ginseng::database db;
+    const auto id = db.create_entity();
+    db.add_component(id, first_after_queries{ 1 });
+    db.get_query<first_after_queries>();
+    db.get_query<ent_id, first_after_queries>();
+    db.get_query<ent_id, ginseng::optional<first_after_queries>>();
+    db.add_component(id, second_after_queries{ 2 });
+    // every entity's component bitset is as wide as the largest guid, queries must not widen it
+    expect(db.get_fragmentation<second_after_queries>().guid == db.get_fragmentation<first_after_queries>().guid + 1);
+  };
+
+  "compact keeps every component on its entity"_test = [] {
+    ginseng::database db;
+    auto ids = populate(db, 3'000, 17);
+    // holes all over velocity's storage, and a few in position's
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+      if (i % 3 != 0 && db.has_component<velocity>(ids[i])) { db.remove_component<velocity>(ids[i]); }
+    }
+    for (std::size_t i = 0; i < ids.size(); i += 10) { db.destroy_entity(ids[i]); }
+    std::erase_if(ids, [&](ent_id id) { return !db.exists(id); });
+
+    struct snapshot
+    {
+      std::vector<position> positions;
+      std::vector<std::optional<velocity>> velocities;
+      std::vector<ent_id::index_type> moving;
+      std::size_t size;
+    };
+    auto take = [&] {
+      snapshot result{ positions(db, ids), {}, matches<const velocity &>(db), db.size() };
+      for (const auto id : ids) {
+        result.velocities.push_back(
+          db.has_component<velocity>(id) ? std::optional{ db.get_component<velocity>(id) } : std::nullopt);
+      }
+      return result;
+    };
+    const auto before = take();
+    expect(db.get_fragmentation<velocity>().fragmentation() > 0.5);
+
+    db.compact<velocity>();
+    expect(db.get_fragmentation<velocity>().fragmentation() == 0.0);
+    expect(db.get_fragmentation<position>().fragmentation() > 0.0) << "only velocity was compacted";
+    db.compact();
+    expect(db.get_fragmentation<position>().fragmentation() == 0.0);
+
+    // the same ent_ids still reach the same components
+    const auto after = take();
+    expect(after.positions == before.positions);
+    expect(after.moving == before.moving);
+    expect(after.size == before.size);
+    expect(db.count<velocity>() == before.moving.size());
+    expect(after.velocities == before.velocities);
+
+    // a component added afterwards goes right after the packed ones
+    const auto id = db.create_entity();
+    db.add_component(id, velocity{ 5, 6 });
+    expect(db.get_component<velocity>(id).x == 5);
+    expect(db.get_fragmentation<velocity>().fragmentation() == 0.0);
+  };
+  "archetype_database matches database"_test = [] {
+    int database_live = 0;
+    int archetype_live = 0;
+    {
+      using archetype_id = ginseng::archetype_database::ent_id;
+      ginseng::database db;
+      ginseng::archetype_database arch;
+      // the same entity in both, by slot; destroyed entities are swapped out with the last one
+      std::vector<ent_id> db_ids;
+      std::vector<archetype_id> arch_ids;
+      std::mt19937 random(23);
+
+      const auto add = [&](std::size_t slot, unsigned kind, std::int64_t value) {
+        switch (kind) {
+        case 0:
+          db.add_component(db_ids[slot], position{ value, 0 });
+          arch.add_component(arch_ids[slot], position{ value, 0 });
+          break;
+        case 1:
+          db.add_component(db_ids[slot], velocity{ value, 0 });
+          arch.add_component(arch_ids[slot], velocity{ value, 0 });
+          break;
+        case 2:
+          db.add_component(db_ids[slot], wide{ value });
+          arch.add_component(arch_ids[slot], wide{ value });
+          break;
+        case 3:
+          db.add_component(db_ids[slot], tracked(&database_live, value));
+          arch.add_component(arch_ids[slot], tracked(&archetype_live, value));
+          break;
+        default:
+          db.add_component(db_ids[slot], frozen{});
+          arch.add_component(arch_ids[slot], frozen{});
+          break;
+        }
+      };
+      // database must not be asked to remove a component the entity lacks, archetype_database ignores it
+      const auto remove = [&]<typename Com>(std::size_t slot) {
+        if (db.has_component<Com>(db_ids[slot])) { db.remove_component<Com>(db_ids[slot]); }
+        arch.remove_component<Com>(arch_ids[slot]);
+      };
+      const auto create = [&] {
+        db_ids.push_back(db.create_entity());
+        arch_ids.push_back(arch.create_entity());
+      };
+
+      bool aligned = true;
+      const auto check = [&](const char *step) {
+        expect(db.size() == arch.size() && arch.size() == arch_ids.size()) << step;
+        expect(db.count<position>() == arch.count<position>()) << step;
+        expect(db.count<velocity>() == arch.count<velocity>()) << step;
+        expect(db.count<wide>() == arch.count<wide>()) << step;
+        expect(db.count<tracked>() == arch.count<tracked>()) << step;
+        // database keeps no count of tags
+        const auto frozen_count = std::count_if(
+          arch_ids.begin(), arch_ids.end(), [&](archetype_id id) { return arch.has_component<frozen>(id); });
+        expect(arch.count<frozen>() == static_cast<std::size_t>(frozen_count)) << step;
+        expect(static_cast<std::size_t>(archetype_live) == arch.count<tracked>()) << step;
+        expect(static_cast<std::size_t>(database_live) == db.count<tracked>()) << step;
+        expect(lookups(db, db_ids) == lookups(arch, arch_ids)) << step;
+        expect(visits(db, db_ids, aligned) == visits(arch, arch_ids, aligned)) << step;
+        expect(aligned) << step;
+      };
+
+      // one archetype many chunks long, with a column that needs padding in front of it
+      for (int i = 0; i < 3'000; ++i) {
+        create();
+        add(db_ids.size() - 1, 0, i);
+        add(db_ids.size() - 1, 2, i);
+        add(db_ids.size() - 1, 3, i);
+      }
+      check("populated");
+
+      for (int step = 1; step <= 30'000; ++step) {
+        const auto slot = random() % db_ids.size();
+        const auto kind = static_cast<unsigned>(random() % 5);
+        switch (random() % 6) {
+        case 0:
+          create();
+          for (unsigned k = 0; k < 5; ++k) {
+            if (random() % 2 == 0) { add(db_ids.size() - 1, k, step); }
+          }
+          break;
+        case 1:
+          db.destroy_entity(db_ids[slot]);
+          arch.destroy_entity(arch_ids[slot]);
+          db_ids[slot] = db_ids.back();
+          db_ids.pop_back();
+          arch_ids[slot] = arch_ids.back();
+          arch_ids.pop_back();
+          break;
+        case 2:
+        case 3: add(slot, kind, step); break;
+        default:
+          switch (kind) {
+          case 0: remove.operator()<position>(slot); break;
+          case 1: remove.operator()<velocity>(slot); break;
+          case 2: remove.operator()<wide>(slot); break;
+          case 3: remove.operator()<tracked>(slot); break;
+          default: remove.operator()<frozen>(slot); break;
+          }
+          break;
+        }
+        if (step % 5'000 == 0) {
+          // components written through a visit land on the same entities
+          db.visit([](position &p, const velocity &v) { p.x += v.x; });
+          arch.visit([](position &p, const velocity &v) { p.x += v.x; });
+          check("churned");
+        }
+      }
+      // at most one archetype per set of components, the edges lead back to the same ones
+      expect(arch.archetype_count() <= 32u);
+
+      // entities made again take the destroyed slots
+      for (int i = 0; i < 1'000; ++i) {
+        create();
+        add(db_ids.size() - 1, static_cast<unsigned>(i) % 5, i);
+      }
+      check("created again");
+    }
+    expect(database_live == 0 && archetype_live == 0) << "every tracked component destroyed exactly once";
+  };
+};
+
+}// namespace
@@ -0,0 +1,43 @@
+import board;
+import evaluation;
+#include <boost/ut.hpp>
+#include <cstdint>
+#include <random>
+
+namespace {
+
+// every position of random games, from the empty board until a win or a full board
+template<typename Board> void check_random_games(int games, unsigned seed)
+{
+  using namespace boost::ut;
+  std::mt19937 random(seed);
+  for (int game = 0; game < games; ++game) {
+    Board b;
+    bool over = false;
+    while (true) {
+      expect(evaluate_threats(b) == evaluate_threats_reference(b))
+        << "game " << game << " after " << static_cast<int>(b.moves_played()) << " moves";
+      if (over || b.moves_played() == Board::cells) { break; }
+      const auto legal = b.legal_moves();
+      const auto column = legal.moves[random() % legal.size];
+      over = b.check_winner_at(*b.play(column), column);
+    }
+  }
+}
+
+boost::ut::suite evaluation_tests = [] {
+  using namespace boost::ut;
+
+  "evaluate_threats matches the reference on the standard board"_test = [] { check_random_games<board>(200, 41); };
+
+  "evaluate_threats matches the reference on 7 rows by 9 columns"_test = [] {
+    // the masks need more than 64 bits here
+    check_random_games<basic_board<7, 9, 4>>(200, 43);
+  };
+
+  "evaluate_threats matches the reference on 9 rows by 7 columns"_test = [] {
+    check_random_games<basic_board<9, 7, 5>>(200, 47);
+  };
+};
+
+}// namespace
@@ -0,0 +1,73 @@
+import board;
+import mcts;
+#include <boost/ut.hpp>
+#include <cstdint>
+#include <random>
+#include <string_view>
+
+namespace {
+
+board from_moves(std::string_view moves)
+{
+  board b;
+  for (const auto move : moves) { b.play(static_cast<std::uint8_t>(move - '1')); }
+  return b;
+}
+
+constexpr std::uint64_t playouts = 20'000;
+// only the playout count may stop the search, not the clock
+constexpr std::int64_t no_deadline = 60'000;
+
+boost::ut::suite mcts_tests = [] {
+  using namespace boost::ut;
+
+  "mcts takes a win and blocks a loss"_test = [] {
+    mcts tree(16);
+    for (const int threads : { 1, 4 }) {
+      const mcts_limits limits{ no_deadline, playouts, static_cast<std::uint8_t>(threads) };
+      // the first player has three in the bottom row, the fourth wins
+      const auto win = tree.search(from_moves("112233"), limits);
+      expect(win.best_move == 3) << "threads " << threads;
+      expect(win.win_rate > 0.9) << "threads " << threads;
+      // the same three with the second player to move, who must block
+      const auto block = tree.search(from_moves("11223"), limits);
+      expect(block.best_move == 3) << "threads " << threads;
+    }
+  };
+
+  "mcts stops at the playout limit"_test = [] {
+    mcts tree(16);
+    for (const int threads : { 1, 2, 4 }) {
+      for (const std::uint64_t limit : { 1u, 100u, 5'000u }) {
+        const auto report = tree.search(board{}, { no_deadline, limit, static_cast<std::uint8_t>(threads) });
+        // every thread may have one playout under way when the limit is reached
+        expect(report.playouts >= limit && report.playouts < limit + static_cast<std::uint64_t>(threads))
+          << "threads " << threads << " limit " << limit << " playouts " << report.playouts;
+        expect(report.tree_nodes <= tree.capacity());
+      }
+    }
+  };
+
+  "mcts best move is always legal"_test = [] {
+    std::mt19937 random(29);
+    // the smallest arena, searches reuse it from the root every time
+    mcts tree(1);
+    for (int game = 0; game < 40; ++game) {
+      board b;
+      bool over = false;
+      while (!over && b.moves_played() < board::cells) {
+        const auto threads = static_cast<std::uint8_t>(1 + random() % 4);
+        const std::uint64_t limit = 1 + random() % 2'000;
+        const auto move = tree.search(b, { no_deadline, limit, threads }).best_move;
+        expect(b.can_play(move)) << "game " << game << " after " << static_cast<int>(b.moves_played()) << " moves";
+        if (!b.can_play(move)) { break; }
+        // random games, so the positions are not only the ones mcts likes
+        const auto legal = b.legal_moves();
+        const auto column = random() % 2 == 0 ? move : legal.moves[random() % legal.size];
+        over = b.check_winner_at(*b.play(column), column);
+      }
+    }
+  };
+};
+
+}// namespace
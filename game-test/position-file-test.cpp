@@ -0,0 +1,139 @@
+import board;
+import position_file;
+import solver;
+import transposition_table;
+#include <boost/ut.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+board from_moves(std::string_view moves)
+{
+  board b;
+  for (const auto move : moves) { b.play(static_cast<std::uint8_t>(move - '1')); }
+  return b;
+}
+
+std::string mirror(std::string_view moves)
+{
+  std::string mirrored;
+  for (const auto move : moves) { mirrored += static_cast<char>('1' + board::columns - 1 - (move - '1')); }
+  return mirrored;
+}
+
+std::string temp_path(std::string_view name)
+{
+  return (std::filesystem::temp_directory_path() / ("game-test-" + std::string(name))).string();
+}
+
+std::vector<char> read_bytes(const std::string &path)
+{
+  std::ifstream in(path, std::ios::binary);
+  return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+}
+
+void write_bytes(const std::string &path, const std::vector<char> &bytes)
+{
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// 28 pieces, no winner, and none of its replies wins at once
+constexpr std::string_view root_moves = "7715134371541242366123154425";
+
+boost::ut::suite position_file_tests = [] {
+  using namespace boost::ut;
+
+  "position files give back what was written"_test = [] {
+    transposition_table table(16);
+    solver exact(0, &table);
+    const auto root = from_moves(root_moves);
+    expect(root.moves_played() == 28u && !root.check_winner(piece::red) && !root.check_winner(piece::yellow));
+
+    // the root and every reply to it
+    std::vector<board> positions{ root };
+    std::vector<std::uint64_t> records{ make_position_record(root, exact.solve(root).score) };
+    for (const auto column : root.legal_moves()) {
+      auto child = root;
+      expect(!child.check_winner_at(*child.play(column), column));
+      positions.push_back(child);
+      records.push_back(make_position_record(child, exact.solve(child).score));
+    }
+    const auto path = temp_path("positions.bin");
+    expect(write_position_file(path, 28, 29, records));
+
+    const auto file = position_file::open(path);
+    expect(file.has_value());
+    if (!file) { return; }
+    expect(file->size() == positions.size());
+    expect(file->header().min_moves == 28 && file->header().max_moves == 29);
+    for (const auto &position : positions) {
+      const auto score = file->score(position);
+      expect(score.has_value() && *score == exact.solve(position).score);
+    }
+
+    // a mirrored position is found through its mirror's record
+    const auto mirrored = from_moves(mirror(root_moves));
+    expect(mirrored.key() != root.key());
+    expect(file->score(mirrored) == file->score(root));
+
+    // outside [min_moves, max_moves] there is no score, even for a position that was solved
+    auto before = root;
+    before.undo();
+    expect(!file->score(before).has_value());
+    auto after = positions.back();
+    after.play(after.legal_moves().moves[0]);
+    expect(!file->score(after).has_value());
+    // and inside it only the positions written have one
+    expect(!file->score(from_moves("7715134371541242366123154452")).has_value());
+
+    // the move leads to the child the root's score comes from
+    const auto move = file->best_move(root);
+    expect(move.has_value() && root.can_play(*move));
+    if (move) {
+      auto child = root;
+      child.play(*move);
+      expect(-exact.solve(child).score == exact.solve(root).score);
+    }
+    // the children of a child are not in the file
+    expect(!file->best_move(positions.back()).has_value());
+    std::filesystem::remove(path);
+  };
+
+  "position files that do not fit are rejected"_test = [] {
+    const auto root = from_moves(root_moves);
+    std::vector<std::uint64_t> records{ make_position_record(root, 0) };
+    const auto path = temp_path("good.bin");
+    expect(write_position_file(path, 28, 28, records));
+    const auto good = read_bytes(path);
+    expect(position_file::open(path).has_value());
+
+    const auto bad_path = temp_path("bad.bin");
+    // cut short: in the records, in the header, and nothing at all
+    for (const std::size_t bytes : { good.size() - 1, sizeof(position_file_header) - 1, std::size_t{ 0 } }) {
+      write_bytes(bad_path, { good.begin(), good.begin() + static_cast<std::ptrdiff_t>(bytes) });
+      expect(!position_file::open(bad_path).has_value()) << bytes << " bytes";
+    }
+    // made for another board
+    for (const auto offset : { offsetof(position_file_header, rows),
+           offsetof(position_file_header, columns),
+           offsetof(position_file_header, connect) }) {
+      auto bytes = good;
+      ++bytes[offset];
+      write_bytes(bad_path, bytes);
+      expect(!position_file::open(bad_path).has_value()) << "header byte " << offset;
+    }
+    std::filesystem::remove(bad_path);
+    std::filesystem::remove(path);
+    expect(!position_file::open(path).has_value()) << "missing file";
+  };
+};
+
+}// namespace
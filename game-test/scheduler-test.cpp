@@ -0,0 +1,147 @@
+import rooster;
+#include <algorithm>
+#include <atomic>
+#include <boost/ut.hpp>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct counter
+{
+  int value;
+};
+struct seen
+{
+  int value;
+};
+struct left
+{
+};
+struct right
+{
+};
+
+using namespace std::chrono_literals;
+
+// true once `count` callers are inside at the same time, false when that takes longer than a second
+bool meet(std::atomic<int> &arrived, int count)
+{
+  arrived.fetch_add(1);
+  const auto give_up = std::chrono::steady_clock::now() + 1s;
+  while (arrived.load() < count) {
+    if (std::chrono::steady_clock::now() > give_up) { return false; }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+boost::ut::suite scheduler_tests = [] {
+  using namespace boost::ut;
+
+  "conflicting systems run in the order they were added"_test = [] {
+    ginseng::database db;
+    const auto id = db.create_entity();
+    db.add_component(id, counter{ 0 });
+    db.add_component(id, seen{ 0 });
+
+    rooster::scheduler scheduler(2);
+    scheduler.add("write", [](ginseng::database &reg) { reg.visit([](counter &c) { ++c.value; }); },
+      rooster::reads<>{}, rooster::writes<counter>{});
+    scheduler.add(
+      "read",
+      [](ginseng::database &reg) { reg.visit([](const counter &c, seen &s) { s.value = c.value; }); },
+      rooster::reads<counter>{},
+      rooster::writes<seen>{});
+    // after the reader, so it must wait for the reader to be done with counter
+    scheduler.add("write again", [](ginseng::database &reg) { reg.visit([](counter &c) { c.value *= 10; }); },
+      rooster::reads<>{}, rooster::writes<counter>{});
+
+    for (int frame = 0; frame < 50; ++frame) {
+      db.get_component<counter>(id).value = frame;
+      scheduler.run(db);
+      expect(db.get_component<seen>(id).value == frame + 1) << "frame " << frame;
+      expect(db.get_component<counter>(id).value == (frame + 1) * 10) << "frame " << frame;
+    }
+    expect(scheduler.size() == 3u);
+    expect(scheduler.name(1) == "read");
+  };
+
+  "systems that share nothing run at the same time"_test = [] {
+    ginseng::database db;
+    rooster::scheduler scheduler(2);
+    std::atomic<int> arrived = 0;
+    bool met_left = false;
+    bool met_right = false;
+    scheduler.add("left", [&](ginseng::database &) { met_left = meet(arrived, 2); },
+      rooster::reads<counter>{}, rooster::writes<left>{});
+    scheduler.add("right", [&](ginseng::database &) { met_right = meet(arrived, 2); },
+      rooster::reads<counter>{}, rooster::writes<right>{});
+    scheduler.run(db);
+    expect(met_left && met_right);
+    expect(scheduler.workers() <= 2u);
+  };
+
+  "main thread systems run on the thread calling run"_test = [] {
+    ginseng::database db;
+    rooster::scheduler scheduler(2);
+    std::vector<std::thread::id> threads(3);
+    scheduler.add("main", [&](ginseng::database &) { threads[0] = std::this_thread::get_id(); },
+      rooster::reads<>{}, rooster::writes<left>{}, rooster::system_thread::main);
+    scheduler.add("any", [&](ginseng::database &) { threads[1] = std::this_thread::get_id(); },
+      rooster::reads<>{}, rooster::writes<right>{});
+    scheduler.add("undeclared", [&](ginseng::database &) { threads[2] = std::this_thread::get_id(); });
+    for (int frame = 0; frame < 20; ++frame) {
+      scheduler.run(db);
+      expect(threads[0] == std::this_thread::get_id());
+      expect(threads[2] == std::this_thread::get_id());
+    }
+  };
+
+  "undeclared systems run alone"_test = [] {
+    ginseng::database db;
+    rooster::scheduler scheduler(2);
+    std::atomic<int> running = 0;
+    std::atomic<int> most_beside = 0;
+    auto declared = [&](ginseng::database &) {
+      running.fetch_add(1);
+      std::this_thread::sleep_for(1ms);
+      running.fetch_sub(1);
+    };
+    scheduler.add("before left", declared, rooster::reads<>{}, rooster::writes<left>{});
+    scheduler.add("before right", declared, rooster::reads<>{}, rooster::writes<right>{});
+    scheduler.add("alone", [&](ginseng::database &) {
+      most_beside = std::max(most_beside.load(), running.load());
+      std::this_thread::sleep_for(1ms);
+      most_beside = std::max(most_beside.load(), running.load());
+    });
+    scheduler.add("after left", declared, rooster::reads<>{}, rooster::writes<left>{});
+    scheduler.add("after right", declared, rooster::reads<>{}, rooster::writes<right>{});
+    for (int frame = 0; frame < 20; ++frame) { scheduler.run(db); }
+    expect(most_beside.load() == 0);
+  };
+
+  "the critical path is the longest chain of conflicting systems"_test = [] {
+    ginseng::database db;
+    rooster::scheduler scheduler(2);
+    auto sleep_for = [](auto time) { return [time](ginseng::database &) { std::this_thread::sleep_for(time); }; };
+    scheduler.add("a", sleep_for(5ms), rooster::reads<>{}, rooster::writes<counter>{});
+    scheduler.add("side", sleep_for(4ms), rooster::reads<>{}, rooster::writes<right>{});
+    scheduler.add("b", sleep_for(5ms), rooster::reads<counter>{}, rooster::writes<seen>{});
+    scheduler.add("c", sleep_for(5ms), rooster::reads<seen>{}, rooster::writes<left>{});
+    scheduler.run(db);
+
+    const auto &frame = scheduler.last_frame();
+    expect(frame.critical_path == std::vector<std::size_t>{ 0, 2, 3 });
+    expect(frame.system_ms.size() == 4u);
+    expect(frame.critical_path_ms >= 15.0);
+    expect(frame.critical_path_ms <= frame.work_ms);
+    expect(frame.critical_path_ms <= frame.frame_ms);
+    // the side system runs beside the chain, not after it
+    expect(frame.frame_ms < frame.work_ms);
+  };
+};
+
+}// namespace
@@ -0,0 +1,143 @@
+import board;
+import parallel_solver;
+import search;
+import solver;
+import transposition_table;
+#include <array>
+#include <boost/ut.hpp>
+#include <cstdint>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// random games stopped after a number of plies, none of them already won
+std::vector<board> random_positions(std::size_t count, int min_plies, int max_plies)
+{
+  std::mt19937 random(13);
+  std::vector<board> positions;
+  while (positions.size() < count) {
+    board b;
+    const auto plies = min_plies + static_cast<int>(random() % static_cast<unsigned>(max_plies - min_plies + 1));
+    bool won = false;
+    while (!won && b.moves_played() < plies) {
+      const auto legal = b.legal_moves();
+      const auto column = legal.moves[random() % legal.size];
+      won = b.check_winner_at(*b.play(column), column);
+    }
+    if (!won) { positions.push_back(b); }
+  }
+  return positions;
+}
+
+board from_moves(std::string_view moves)
+{
+  board b;
+  for (const auto move : moves) { b.play(static_cast<std::uint8_t>(move - '1')); }
+  return b;
+}
+
+// plain alpha-beta with the solver's scoring and nothing else, to check the solver against
+int reference_negamax(board &position, int alpha, int beta)
+{
+  const int moves = position.moves_played();
+  if (moves == board::cells) { return 0; }
+  for (const auto column : position.legal_moves()) {
+    const bool wins = position.check_winner_at(*position.play(column), column);
+    position.undo();
+    if (wins) { return (board::cells + 1 - moves) / 2; }
+  }
+  for (const auto column : position.legal_moves()) {
+    position.play(column);
+    const int score = -reference_negamax(position, -beta, -alpha);
+    position.undo();
+    if (score >= beta) { return score; }
+    if (score > alpha) { alpha = score; }
+  }
+  return alpha;
+}
+
+boost::ut::suite solver_tests = [] {
+  using namespace boost::ut;
+
+  "solver scores known endgames"_test = [] {
+    transposition_table table(16);
+    // the side to move wins now, with its 4th piece
+    expect(solver(0, &table).solve(from_moves("112233")).score == 18);
+    // from the Test_L3_R1 set of Pascal Pons' solver tutorial, which scores positions the same way
+    constexpr std::array<std::pair<std::string_view, int>, 3> endgames{ {
+      { "2252576253462244111563365343671351441", -1 },
+      { "23163416124767223154467471272416755633", 0 },
+      { "65214673556155731566316327373221417", -1 },
+    } };
+    for (const auto &[moves, score] : endgames) {
+      table.clear();
+      const auto result = solver(0, &table).solve(from_moves(moves));
+      expect(result.complete && result.score == score) << moves << " scored " << result.score;
+    }
+  };
+
+  "solver matches plain alpha-beta"_test = [] {
+    transposition_table table(16);
+    for (const auto &position : random_positions(40, 31, 33)) {
+      auto scratch = position;
+      const int expected = reference_negamax(scratch, -board::cells, board::cells);
+      table.clear();
+      expect(solver(0, &table).solve(position).score == expected);
+      // and without a table, where every node is searched
+      expect(solver().solve(position).score == expected);
+    }
+  };
+
+  "parallel solver scores match the serial solver"_test = [] {
+    transposition_table serial_table(16);
+    transposition_table parallel_table(16);
+    for (const auto &position : random_positions(12, 22, 30)) {
+      serial_table.clear();
+      const auto expected = solver(0, &serial_table).solve(position);
+      expect(expected.complete);
+      // a low split depth so even these small trees are split and stolen from
+      for (const int threads : { 1, 2, 4 }) {
+        parallel_table.clear();
+        parallel_solver parallel(parallel_table, static_cast<std::uint8_t>(threads), 6);
+        expect(parallel.solve(position).score == expected.score) << "threads " << threads;
+        // a single window answers the same question as the serial solver's
+        parallel_table.clear();
+        const auto bound = parallel.search(position, expected.score - 1, expected.score);
+        expect(bound.score >= expected.score);
+      }
+    }
+  };
+
+  "lazy smp finds the same proven results as one thread"_test = [] {
+    transposition_table table(16);
+    transposition_table helpers_table(16);
+    transposition_table solver_table(16);
+    for (const auto &position : random_positions(12, 28, 34)) {
+      // deep enough to reach the end of the game, so the scores are exact
+      const search_limits limits{ 60'000, board::cells, 1, nullptr };
+      table.clear();
+      const auto single = searcher(table).search(position, limits);
+      helpers_table.clear();
+      auto with_helpers = limits;
+      with_helpers.threads = 4;
+      const auto lazy = searcher(helpers_table).search(position, with_helpers);
+      expect(single.score == lazy.score);
+
+      // the move played must keep the solver's score, whoever found it
+      solver_table.clear();
+      solver exact(0, &solver_table);
+      const auto score = exact.solve(position).score;
+      auto after = position;
+      const auto column = lazy.best_move();
+      expect(after.can_play(column));
+      const bool wins = after.check_winner_at(*after.play(column), column);
+      expect(wins ? score > 0 : -exact.solve(after).score == score);
+      expect((score > 0) == (lazy.score > 0) && (score < 0) == (lazy.score < 0));
+    }
+  };
+};
+
+}// namespace
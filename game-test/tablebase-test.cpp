@@ -0,0 +1,94 @@
+import board;
+import position_file;
+import solver;
+import tablebase;
+import transposition_table;
+#include <boost/ut.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+// random games stopped at moves pieces, none of them already won
+std::vector<board> random_seeds(std::size_t count, int moves, unsigned seed)
+{
+  std::mt19937 random(seed);
+  std::vector<board> seeds;
+  while (seeds.size() < count) {
+    board b;
+    bool won = false;
+    while (!won && b.moves_played() < moves) {
+      const auto legal = b.legal_moves();
+      const auto column = legal.moves[random() % legal.size];
+      won = b.check_winner_at(*b.play(column), column);
+    }
+    if (!won) { seeds.push_back(b); }
+  }
+  return seeds;
+}
+
+// every position the table should hold, one of each mirrored pair
+std::vector<board> reachable(const std::vector<board> &seeds)
+{
+  std::vector<board> positions;
+  std::unordered_set<std::uint64_t> seen;
+  std::vector<board> pending = seeds;
+  while (!pending.empty()) {
+    const auto position = pending.back();
+    pending.pop_back();
+    if (!seen.insert(static_cast<std::uint64_t>(position.symmetric_key())).second) { continue; }
+    positions.push_back(position);
+    for (const auto column : position.legal_moves()) {
+      auto child = position;
+      if (!child.check_winner_at(*child.play(column), column)) { pending.push_back(child); }
+    }
+  }
+  return positions;
+}
+
+boost::ut::suite tablebase_tests = [] {
+  using namespace boost::ut;
+
+  "tablebase scores match the solver"_test = [] {
+    for (const int empty_cells : { 8, 10 }) {
+      const auto seeds = random_seeds(3, board::cells - empty_cells, static_cast<unsigned>(empty_cells));
+      auto records = solve_endgames(seeds, static_cast<std::uint8_t>(empty_cells));
+      const auto name = "game-test-tablebase-" + std::to_string(empty_cells) + ".bin";
+      const auto path = (std::filesystem::temp_directory_path() / name).string();
+      expect(write_position_file(path, static_cast<std::uint8_t>(board::cells - empty_cells), board::cells, records));
+      const auto table_file = position_file::open(path);
+      expect(table_file.has_value());
+      if (!table_file) { continue; }
+
+      const auto positions = reachable(seeds);
+      expect(table_file->size() == positions.size()) << "empty cells " << empty_cells;
+      transposition_table table(16);
+      solver exact(0, &table);
+      for (const auto &position : positions) {
+        const auto score = table_file->score(position);
+        expect(score.has_value() && *score == exact.solve(position).score)
+          << "empty cells " << empty_cells << " after " << static_cast<int>(position.moves_played()) << " moves";
+      }
+
+      // a solver that looks the endgames up must not change its answers, from the seeds or above them
+      transposition_table lookup_table(16);
+      solver lookup(0, &lookup_table);
+      lookup.use_tablebase(&*table_file);
+      for (auto position : seeds) {
+        for (int up = 0; up < 3; ++up, position.undo()) {
+          table.clear();
+          lookup_table.clear();
+          expect(lookup.solve(position).score == solver(0, &table).solve(position).score)
+            << "empty cells " << empty_cells << " after " << static_cast<int>(position.moves_played()) << " moves";
+        }
+      }
+      std::filesystem::remove(path);
+    }
+  };
+};
+
+}// namespace
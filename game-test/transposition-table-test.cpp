@@ -0,0 +1,61 @@
+import transposition_table;
+#include <boost/ut.hpp>
+#include <cstdint>
+#include <initializer_list>
+
+namespace {
+
+bool operator==(const tt_entry &a, const tt_entry &b)
+{
+  return a.bound == b.bound && a.score == b.score && a.move == b.move && a.depth == b.depth;
+}
+
+boost::ut::suite transposition_table_tests = [] {
+  using namespace boost::ut;
+
+  "entries come back as they were stored"_test = [] {
+    transposition_table table(1);
+    tt_stats stats{};
+    std::uint64_t key = 0x1234'5678'9abc;
+    // the edges of every field, negative scores included
+    for (const auto bound : { tt_bound::lower, tt_bound::upper, tt_bound::exact }) {
+      for (const int score : { 0, 1, -1, 21, -21, 32767, -32768 }) {
+        for (const int move : { 0, 6, 63 }) {
+          for (const int depth : { 0, 1, 42, 255 }) {
+            const tt_entry entry{
+              bound, static_cast<std::int16_t>(score), static_cast<std::uint8_t>(move), static_cast<std::uint8_t>(depth)
+            };
+            key = key * 6364136223846793005u + 1442695040888963407u;
+            table.store(key, entry);
+            const auto found = table.probe(key, stats);
+            expect(found.has_value() && *found == entry)
+              << "score " << score << " move " << move << " depth " << depth;
+          }
+        }
+      }
+    }
+    expect(stats.misses == 0u && stats.collisions == 0u);
+  };
+
+  "an empty slot is a miss and another key a collision"_test = [] {
+    transposition_table table(1);
+    tt_stats stats{};
+    const std::uint64_t key = 12345;
+    expect(!table.probe(key, stats).has_value());
+    expect(stats.misses == 1u);
+
+    // the key's fragment is 0 and so is every field but the bound, only the bound tells it from an empty slot
+    table.store(key, { tt_bound::lower, 0, 0, 0 });
+    expect(table.probe(key, stats).has_value());
+    // the same slot, the stored fragment differs
+    const auto other = key + table.size();
+    expect(!table.probe(other, stats).has_value());
+    expect(stats.collisions == 1u && stats.hits == 1u);
+
+    table.clear();
+    expect(!table.probe(key, stats).has_value());
+    expect(stats.misses == 2u);
+  };
+};
+
+}// namespace
@@ -0,0 +1,85 @@
+import board;
+import position_file;
+import solver;
+import transposition_table;
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// every position with at most max_moves pieces and no winner, one of each mirrored pair
+std::vector<board> enumerate(std::uint8_t max_moves)
+{
+  std::vector<board> positions{ board{} };
+  std::vector<board> layer{ board{} };
+  for (std::uint8_t moves = 1; moves <= max_moves; ++moves) {
+    std::unordered_set<std::uint64_t> seen;
+    std::vector<board> next;
+    for (const auto &position : layer) {
+      for (const auto column : position.legal_moves()) {
+        auto child = position;
+        const auto row = child.play(column);
+        if (child.check_winner_at(*row, column)) { continue; }
+        if (seen.insert(static_cast<std::uint64_t>(child.symmetric_key())).second) { next.push_back(child); }
+      }
+    }
+    positions.insert(positions.end(), next.begin(), next.end());
+    layer = std::move(next);
+  }
+  return positions;
+}
+
+// usage: book-gen <max moves> <output file> [threads]
+// solves every position with up to max moves pieces, with one solver and table per thread
+int main(int argc, char *argv[])
+{
+  if (argc < 3) {
+    fmt::print(stderr, "usage: {} <max moves> <output file> [threads]\n", argv[0]);
+    return 1;
+  }
+  const auto max_moves = static_cast<std::uint8_t>(std::clamp(std::atoi(argv[1]), 0, board::cells - 1));
+  const std::string path = argv[2];
+  // a count that is 0 or not a number would start no workers and write a book of zeros
+  const auto threads =
+    argc > 3 ? static_cast<unsigned>(std::max(1, std::atoi(argv[3]))) : std::max(1u, std::thread::hardware_concurrency());
+
+  const auto positions = enumerate(max_moves);
+  fmt::print("{} positions with up to {} moves\n", positions.size(), max_moves);
+
+  std::vector<std::uint64_t> records(positions.size());
+  std::atomic<std::size_t> next = 0;
+  std::atomic<std::size_t> done = 0;
+  {
+    std::vector<std::jthread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+      workers.emplace_back([&] {
+        transposition_table table(64);
+        solver s(0, &table);
+        // neighbours in the list share most of their tree, so each thread takes a run of them
+        constexpr std::size_t batch = 64;
+        for (auto first = next.fetch_add(batch); first < positions.size(); first = next.fetch_add(batch)) {
+          const auto last = std::min(first + batch, positions.size());
+          for (auto index = first; index < last; ++index) {
+            records[index] = make_position_record(positions[index], s.solve(positions[index]).score);
+          }
+          const auto total = done.fetch_add(last - first) + (last - first);
+          fmt::print("\r{}/{} solved", total, positions.size());
+          std::fflush(stdout);
+        }
+      });
+    }
+  }
+  fmt::print("\n");
+
+  if (!write_position_file(path, 0, max_moves, records)) {
+    fmt::print(stderr, "could not write {}\n", path);
+    return 1;
+  }
+  fmt::print("wrote {} records to {}\n", records.size(), path);
+  return 0;
+}
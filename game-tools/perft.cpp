@@ -0,0 +1,146 @@
+import board;
+import rooster;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// leaves of the empty 6x7 board for depth 0, 1, 2..., counted by an independent implementation
+constexpr std::array<std::uint64_t, 13> known_counts{
+  1, 7, 49, 343, 2'401, 16'807, 117'649, 823'536, 5'673'234, 39'394'572, 268'031'646, 1'844'590'828, 12'418'296'244
+};
+
+// positions after exactly depth more moves; a win ends the game, so a won position only counts
+// when it is reached by the last move
+std::uint64_t perft(board &position, std::uint8_t depth)
+{
+  if (depth == 0) { return 1; }
+  const auto moves = position.legal_moves();
+  if (depth == 1) { return moves.size; }
+  std::uint64_t leaves = 0;
+  for (const auto column : moves) {
+    const auto row = position.play(column);
+    if (!position.check_winner_at(*row, column)) { leaves += perft(position, depth - 1); }
+    position.undo();
+  }
+  return leaves;
+}
+
+// perft split by root move; the roots' children are the tasks, so more threads than columns still help
+std::array<std::uint64_t, board::columns> divide(const board &position, std::uint8_t depth, unsigned threads)
+{
+  struct task
+  {
+    std::uint8_t root;
+    board position;
+    std::uint8_t depth;
+  };
+  std::vector<task> tasks;
+  std::array<std::atomic<std::uint64_t>, board::columns> counts{};
+  // no root moves at depth 0, the position itself is the only leaf
+  if (depth == 0) { return {}; }
+  for (const auto root : position.legal_moves()) {
+    auto child = position;
+    const auto row = child.play(root);
+    if (depth == 1) {
+      counts[root] = 1;
+    } else if (child.check_winner_at(*row, root)) {
+      continue;
+    } else if (depth == 2) {
+      tasks.push_back({ root, child, 1 });
+    } else {
+      for (const auto column : child.legal_moves()) {
+        auto grandchild = child;
+        const auto grandchild_row = grandchild.play(column);
+        if (!grandchild.check_winner_at(*grandchild_row, column)) {
+          tasks.push_back({ root, grandchild, static_cast<std::uint8_t>(depth - 2) });
+        }
+      }
+    }
+  }
+
+  std::atomic<std::size_t> next = 0;
+  {
+    std::vector<std::jthread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+      workers.emplace_back([&] {
+        for (auto index = next.fetch_add(1); index < tasks.size(); index = next.fetch_add(1)) {
+          auto &t = tasks[index];
+          counts[t.root].fetch_add(perft(t.position, t.depth), std::memory_order_relaxed);
+        }
+      });
+    }
+  }
+  std::array<std::uint64_t, board::columns> result{};
+  for (std::uint8_t column = 0; column < board::columns; ++column) { result[column] = counts[column].load(); }
+  return result;
+}
+
+// usage: perft <depth> [moves] [--divide] [--threads=<count>] [--verify]
+// moves are 1-based columns played from the empty board, --verify checks every depth up to
+// <depth> on the empty board against known_counts instead
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    fmt::print(stderr, "usage: {} <depth> [moves] [--divide] [--threads=<count>] [--verify]\n", argv[0]);
+    return 1;
+  }
+  const auto depth = static_cast<std::uint8_t>(std::atoi(argv[1]));
+  board position;
+  bool split = false;
+  bool verify = false;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 2; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--divide") {
+      split = true;
+    } else if (arg == "--verify") {
+      verify = true;
+    } else if (arg.starts_with("--threads=")) {
+      threads = static_cast<unsigned>(std::max(1, std::atoi(argv[i] + 10)));
+    } else {
+      for (const auto move : arg) {
+        const auto column = static_cast<std::uint8_t>(move - '1');
+        if (column >= board::columns || !position.can_play(column)) {
+          fmt::print(stderr, "illegal move {} in {}\n", move, arg);
+          return 1;
+        }
+        position.play(column);
+      }
+    }
+  }
+
+  if (verify) {
+    bool ok = true;
+    for (std::uint8_t d = 1; d <= depth && d < known_counts.size(); ++d) {
+      std::uint64_t leaves = 0;
+      for (const auto count : divide(board{}, d, threads)) { leaves += count; }
+      const bool match = leaves == known_counts[d];
+      ok = ok && match;
+      fmt::print("depth {:>2} {:>16} {}\n", d, leaves, match ? "ok" : fmt::format("expected {}", known_counts[d]));
+    }
+    return ok ? 0 : 1;
+  }
+
+  const auto start = now();
+  const auto counts = divide(position, depth, threads);
+  const double seconds = std::chrono::duration<double>(now() - start).count();
+  std::uint64_t leaves = 0;
+  for (std::uint8_t column = 0; column < board::columns; ++column) {
+    if (split && position.can_play(column)) { fmt::print("{}: {}\n", column + 1, counts[column]); }
+    leaves += counts[column];
+  }
+  fmt::print("perft {}: {} positions in {:.3f} s, {:.0f} positions/s\n",
+    depth,
+    depth == 0 ? 1 : leaves,
+    seconds,
+    static_cast<double>(leaves) / (seconds > 0 ? seconds : 1));
+  return 0;
+}
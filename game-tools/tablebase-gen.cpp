@@ -0,0 +1,98 @@
+import board;
+import position_file;
+import tablebase;
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Writes the table solve_endgames builds from a set of seeds, either positions read from a file
+// (say the ones an analysis run keeps reaching) or the ends of random games.
+
+// xorshift, the same seeds every run
+struct fast_random
+{
+  std::uint64_t state;
+  std::uint64_t next()
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+};
+
+// random games stopped at first_moves pieces, replayed when somebody wins before that
+std::vector<board> random_seeds(std::size_t count, std::uint8_t first_moves)
+{
+  fast_random random{ 0x2545'f491'4f6c'dd1d };
+  std::vector<board> seeds;
+  while (seeds.size() < count) {
+    board b;
+    bool won = false;
+    while (!won && b.moves_played() < first_moves) {
+      const auto moves = b.legal_moves();
+      const auto column = moves.moves[random.next() % moves.size];
+      const auto row = b.play(column);
+      won = b.check_winner_at(*row, column);
+    }
+    if (!won) { seeds.push_back(b); }
+  }
+  return seeds;
+}
+
+// one game per line as 1-based columns, lines that are illegal, won or too short are skipped
+std::vector<board> file_seeds(const std::string &path, std::uint8_t first_moves)
+{
+  std::vector<board> seeds;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    board b;
+    bool valid = true;
+    for (const auto move : line) {
+      const auto column = static_cast<std::uint8_t>(move - '1');
+      if (column >= board::columns || !b.can_play(column)) {
+        valid = false;
+        break;
+      }
+      const auto row = b.play(column);
+      if (b.check_winner_at(*row, column)) {
+        valid = false;
+        break;
+      }
+    }
+    if (valid && b.moves_played() >= first_moves) { seeds.push_back(b); }
+  }
+  return seeds;
+}
+
+// usage: tablebase-gen <max empty cells> <output file> <random game count | seed file>
+int main(int argc, char *argv[])
+{
+  if (argc < 4) {
+    fmt::print(stderr, "usage: {} <max empty cells> <output file> <random game count | seed file>\n", argv[0]);
+    return 1;
+  }
+  const auto empties = static_cast<std::uint8_t>(std::clamp(std::atoi(argv[1]), 0, static_cast<int>(board::cells)));
+  const std::string path = argv[2];
+  const std::string seed_source = argv[3];
+  const auto first_moves = static_cast<std::uint8_t>(board::cells - empties);
+
+  const bool random = std::all_of(seed_source.begin(), seed_source.end(), [](char c) { return c >= '0' && c <= '9'; });
+  const auto seeds = random ? random_seeds(std::stoul(seed_source), first_moves) : file_seeds(seed_source, first_moves);
+
+  auto records = solve_endgames(seeds, empties, [](std::size_t positions, std::uint8_t empty_cells) {
+    fmt::print("{} positions with {} empty cells\n", positions, empty_cells);
+  });
+
+  if (!write_position_file(path, first_moves, board::cells, records)) {
+    fmt::print(stderr, "could not write {}\n", path);
+    return 1;
+  }
+  fmt::print("wrote {} records from {} seeds to {}\n", records.size(), seeds.size(), path);
+  return 0;
+}
@@ -0,0 +1,204 @@
+module;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+export module ai_player;
+import board;
+import position_file;
+import search;
+import transposition_table;
+
+// Lock-free ring buffer for exactly one producer thread and one consumer thread.
+// Holds Capacity - 1 items, push fails instead of waiting when it is full.
+export template<typename T, std::size_t Capacity> class spsc_queue
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+  // producer only
+  bool push(const T &value)
+  {
+    const auto head = m_head.load(std::memory_order_relaxed);
+    const auto next = (head + 1) & mask;
+    if (next == m_tail.load(std::memory_order_acquire)) { return false; }
+    m_items[head] = value;
+    m_head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only
+  std::optional<T> pop()
+  {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) { return std::nullopt; }
+    const T value = m_items[tail];
+    m_tail.store((tail + 1) & mask, std::memory_order_release);
+    return value;
+  }
+
+private:
+  constexpr static std::size_t mask = Capacity - 1;
+
+  alignas(64) std::atomic<std::size_t> m_head = 0;
+  alignas(64) std::atomic<std::size_t> m_tail = 0;
+  std::array<T, Capacity> m_items{};
+};
+
+// A computer opponent that thinks on its own thread: start hands it a position and returns at once,
+// and the main loop polls every frame until the chosen column comes back through a spsc_queue.
+// While the opponent is to move it can ponder, searching the replies they might make and keeping
+// an answer to each, so the reply that actually comes is often answered without any search.
+// The searcher and its table live behind a pointer so the component can be moved into the registry.
+export class ai_player
+{
+public:
+  explicit ai_player(std::int64_t think_ms = 2000, std::uint8_t threads = 1);
+  ai_player(ai_player &&) noexcept;
+  ai_player &operator=(ai_player &&) noexcept;
+  ~ai_player();
+
+  // positions the book covers are answered from it, without any search
+  void use_book(position_file book);
+  // drops any search still running, the position must have a legal move and no winner yet
+  void start(const board &position);
+  // thinks about the replies to position, with the opponent to move, hovered first; cheap to call
+  // every frame, it only restarts when the position changes or hovered becomes a reply that needs
+  // an answer and has none yet
+  void ponder(const board &position, std::uint8_t hovered);
+  // the column to play once the search is done, never blocks
+  std::optional<std::uint8_t> poll();
+  // stops the search and throws its answer away, blocks only until the searcher notices
+  void cancel();
+
+private:
+  struct state;
+  std::unique_ptr<state> m_state;
+};
+
+module :private;
+
+struct ai_player::state
+{
+  std::int64_t think_ms;
+  std::uint8_t threads;
+  transposition_table table{ 16 };
+  searcher search{ table };
+  // written by the worker, read by the main loop
+  spsc_queue<std::uint8_t, 4> moves;
+  std::atomic<bool> stop = false;
+  std::jthread worker;
+
+  constexpr static std::uint8_t no_answer = 0xff;
+  // the position the answers belong to, the opponent to move
+  std::optional<board> pondered;
+  // the reply searched first by the running ponder
+  std::uint8_t ponder_first = no_answer;
+  // our column for each of the opponent's replies, filled in by the ponder thread
+  std::array<std::atomic<std::uint8_t>, board::columns> answers;
+  std::optional<position_file> book;
+};
+
+ai_player::ai_player(std::int64_t think_ms, std::uint8_t threads) : m_state(std::make_unique<state>())
+{
+  m_state->think_ms = think_ms;
+  m_state->threads = threads;
+  for (auto &answer : m_state->answers) { answer.store(state::no_answer, std::memory_order_relaxed); }
+}
+
+ai_player::ai_player(ai_player &&) noexcept = default;
+ai_player &ai_player::operator=(ai_player &&) noexcept = default;
+
+ai_player::~ai_player()
+{
+  if (m_state) { cancel(); }
+}
+
+void ai_player::use_book(position_file book) { m_state->book = std::move(book); }
+
+void ai_player::start(const board &position)
+{
+  cancel();
+  auto &s = *m_state;
+  if (s.book) {
+    if (const auto move = s.book->best_move(position)) {
+      s.moves.push(*move);
+      return;
+    }
+  }
+  if (s.pondered && s.pondered->moves_played() + 1 == position.moves_played()) {
+    for (const auto column : s.pondered->legal_moves()) {
+      auto reply = *s.pondered;
+      reply.play(column);
+      if (reply.key() != position.key()) { continue; }
+      if (const auto answer = s.answers[column].load(std::memory_order_relaxed); answer != state::no_answer) {
+        s.moves.push(answer);
+        return;
+      }
+    }
+  }
+  s.worker = std::jthread([&s, position] {
+    const auto report = s.search.search(position, { s.think_ms, board::cells, s.threads, &s.stop });
+    if (!s.stop.load(std::memory_order_relaxed)) { s.moves.push(report.best_move()); }
+  });
+}
+
+// a reply the ai will be asked about: legal, and the game goes on after it
+bool needs_answer(const board &position, std::uint8_t column)
+{
+  if (!position.can_play(column)) { return false; }
+  auto reply = position;
+  const auto row = reply.play(column);
+  return !reply.check_winner_at(*row, column) && reply.moves_played() < board::cells;
+}
+
+void ai_player::ponder(const board &position, std::uint8_t hovered)
+{
+  auto &s = *m_state;
+  const bool same = s.pondered && s.pondered->key() == position.key();
+  // hovering a full column or a winning move must not throw away the search that is running
+  if (same
+      && (hovered == s.ponder_first || !needs_answer(position, hovered)
+          || s.answers[hovered].load(std::memory_order_relaxed) != state::no_answer)) {
+    return;
+  }
+  cancel();
+  if (!same) {
+    s.pondered = position;
+    for (auto &answer : s.answers) { answer.store(state::no_answer, std::memory_order_relaxed); }
+  }
+  s.ponder_first = hovered;
+  s.worker = std::jthread([&s, position, hovered] {
+    std::array<std::uint8_t, board::columns + 1> order{ hovered };
+    std::copy(board::centre_first.begin(), board::centre_first.end(), order.begin() + 1);
+    for (const auto column : order) {
+      if (s.stop.load(std::memory_order_relaxed)) { return; }
+      if (!needs_answer(position, column) || s.answers[column].load(std::memory_order_relaxed) != state::no_answer) {
+        continue;
+      }
+      auto reply = position;
+      reply.play(column);
+      // every answer gets a full think, the table it leaves behind speeds up the ones after it
+      const auto report = s.search.search(reply, { s.think_ms, board::cells, s.threads, &s.stop });
+      if (!s.stop.load(std::memory_order_relaxed)) { s.answers[column].store(report.best_move(), std::memory_order_relaxed); }
+    }
+  });
+}
+
+std::optional<std::uint8_t> ai_player::poll() { return m_state->moves.pop(); }
+
+void ai_player::cancel()
+{
+  auto &s = *m_state;
+  s.stop.store(true, std::memory_order_relaxed);
+  if (s.worker.joinable()) { s.worker.join(); }
+  while (s.moves.pop()) {}
+  // the answers found so far stay, a later ponder on the same position picks up from them
+  s.ponder_first = state::no_answer;
+  s.stop.store(false, std::memory_order_relaxed);
+}
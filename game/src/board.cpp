@@ -1,8 +1,12 @@
 module;
 #include <array>
+#include <bit>
 #include <cassert>
+#include <cstdint>
 #include <fmt/core.h>
+#include <optional>
 #include <ranges>// NOLINT
+#include <type_traits>
 #include <algorithm>
 export module board;
 import centurion;
@@ -10,29 +14,211 @@ import rooster;
 
 
 export enum class piece { none, red, yellow };
-export struct board
+
+// boards with more than 64 cells (sentinels included) need the compiler's 128 bit integer
+__extension__ typedef unsigned __int128 wide_mask;
+template<std::size_t Bits> using board_mask_t = std::conditional_t<(Bits <= 64), std::uint64_t, wide_mask>;
+
+// std::popcount that also takes the 128 bit masks
+export template<typename Mask> constexpr int popcount(const Mask mask)
 {
-  constexpr static std::uint8_t rows = 6;
-  constexpr static std::uint8_t columns = 7;
+  if constexpr (sizeof(Mask) <= sizeof(std::uint64_t)) {
+    return std::popcount(mask);
+  } else {
+    return std::popcount(static_cast<std::uint64_t>(mask)) + std::popcount(static_cast<std::uint64_t>(mask >> 64));
+  }
+}
+
+constexpr std::size_t mask_index(const piece piece)
+{
+  assert(piece != piece::none);
+  return piece == piece::red ? 0 : 1;
+}
+
+// Rows x Columns board where ConnectN pieces in a line win. Every mask, shift and hash key
+// is a compile time constant of the instantiation, so each variant gets its own hot path.
+export template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN> struct basic_board
+{
+  constexpr static std::uint8_t rows = Rows;
+  constexpr static std::uint8_t columns = Columns;
+  constexpr static std::uint8_t connect = ConnectN;
   constexpr static std::uint8_t cell_size = 100;
-  board() noexcept;
+  // every column takes rows + 1 bits, the extra one is always empty so shifts never wrap into the next column
+  constexpr static std::uint8_t column_height = rows + 1;
+  constexpr static std::uint8_t cells = rows * columns;
+  using mask_type = board_mask_t<column_height * columns>;
+  static_assert(column_height * columns <= 128, "board does not fit in a 128 bit mask");
+  static_assert(connect > 1 && (connect <= rows || connect <= columns), "nobody can ever win on this board");
+
+  // the playable columns, in ascending order
+  struct move_list
+  {
+    std::array<std::uint8_t, columns> moves;
+    std::uint8_t size;
+    const std::uint8_t *begin() const { return moves.data(); }
+    const std::uint8_t *end() const { return moves.data() + size; }
+  };
+
+  // bit of a cell in the masks, height 0 at the bottom
+  constexpr static std::size_t bit_index(const std::uint8_t column, const std::uint8_t height)
+  {
+    return std::size_t{ column } * column_height + height;
+  }
+  constexpr static mask_type bottom_mask(const std::uint8_t column) { return mask_type{ 1 } << bit_index(column, 0); }
+  constexpr static mask_type bottom_row = [] {
+    mask_type mask = 0;
+    for (std::uint8_t column = 0; column < columns; ++column) { mask |= bottom_mask(column); }
+    return mask;
+  }();
+  // columns from the centre outwards, centre columns take part in more lines so engines try them first
+  constexpr static auto centre_first = [] {
+    std::array<std::uint8_t, columns> order{};
+    for (std::size_t i = 0; i < columns; ++i) {
+      const auto step = static_cast<int>(i + 1) / 2;
+      order[i] = static_cast<std::uint8_t>(i % 2 == 0 ? columns / 2 + step : columns / 2 - step);
+    }
+    return order;
+  }();
+  // every possible line of connect cells: horizontal, vertical and both diagonals
+  constexpr static std::size_t line_count = [] {
+    const auto fits = [](int length) { return length >= connect ? length - connect + 1 : 0; };
+    return rows * fits(columns) + columns * fits(rows) + 2 * fits(rows) * fits(columns);
+  }();
+  constexpr static auto lines = [] {
+    std::array<mask_type, line_count> table{};
+    std::size_t count = 0;
+    // (column, height) steps, height grows upwards like in the masks
+    constexpr std::array<std::array<int, 2>, 4> directions{ { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, -1 } } };
+    for (const auto [column_step, height_step] : directions) {
+      for (int column = 0; column < columns; ++column) {
+        for (int height = 0; height < rows; ++height) {
+          const int last_column = column + (connect - 1) * column_step;
+          const int last_height = height + (connect - 1) * height_step;
+          if (last_column >= columns || last_height < 0 || last_height >= rows) { continue; }
+          mask_type line = 0;
+          for (int i = 0; i < connect; ++i) {
+            line |= mask_type{ 1 } << ((column + i * column_step) * column_height + height + i * height_step);
+          }
+          table[count++] = line;
+        }
+      }
+    }
+    return table;
+  }();
+  // indices into lines of the lines going through one cell
+  struct line_list
+  {
+    std::array<std::uint16_t, 4 * connect> indices;
+    std::uint8_t size;
+    const std::uint16_t *begin() const { return indices.data(); }
+    const std::uint16_t *end() const { return indices.data() + size; }
+  };
+  // indexed like the masks, sentinel cells have no lines
+  constexpr static auto cell_lines = [] {
+    std::array<line_list, column_height * columns> table{};
+    for (std::size_t index = 0; index < line_count; ++index) {
+      for (std::size_t bit = 0; bit < table.size(); ++bit) {
+        if ((lines[index] >> bit) & 1) { table[bit].indices[table[bit].size++] = static_cast<std::uint16_t>(index); }
+      }
+    }
+    return table;
+  }();
+  // one random key per color and cell, indexed like the masks
+  constexpr static auto zobrist_keys = [] {
+    std::array<std::array<std::uint64_t, column_height * columns>, 2> keys{};
+    // splitmix64, good enough to spread the keys and usable at compile time
+    std::uint64_t state = 0x9e37'79b9'7f4a'7c15;
+    for (auto &color : keys) {
+      for (auto &key : color) {
+        state += 0x9e37'79b9'7f4a'7c15;
+        auto z = state;
+        z = (z ^ (z >> 30)) * 0xbf58'476d'1ce4'e5b9;
+        z = (z ^ (z >> 27)) * 0x94d0'49bb'1331'11eb;
+        key = z ^ (z >> 31);
+      }
+    }
+    return keys;
+  }();
+
+  basic_board() noexcept;
   void draw(cen::renderer_handle renderer) const;
   void draw_grid(cen::renderer_handle renderer) const;
   void draw_pieces(cen::renderer_handle renderer) const;
-  void put_piece(const piece piece, const std::uint8_t column);
+  bool can_play(const std::uint8_t column) const { return heights[column] < rows; }
+  move_list legal_moves() const;
+  // returns the row the piece landed on, or nothing when the column is full
+  std::optional<std::uint8_t> put_piece(const piece piece, const std::uint8_t column);
+  // takes the top piece out of the column and returns it, none if the column was empty
+  piece remove_piece(const std::uint8_t column);
+  // put_piece for the side to move, remembered so undo() can take it back
+  std::optional<std::uint8_t> play(const std::uint8_t column);
+  // takes back the last play(), pieces added with put_piece are not on the move stack
+  void undo();
+  // red always starts
+  piece to_move() const { return moves_played() % 2 == 0 ? piece::red : piece::yellow; }
   // when mouse over, draw a placeholder with a dimmed color
   void draw_placeholder(cen::renderer_handle renderer, const cen::ipoint mouse_pos) const;
-  bool check_winner(const piece piece);
+  bool check_winner(const piece piece) const;
+  // only looks at the lines through the given cell, enough after a single put_piece
+  bool check_winner_at(const std::uint8_t row, const std::uint8_t column) const;
+  // rows are counted from the top, like the screen
+  piece at(const std::uint8_t row, const std::uint8_t column) const;
+  std::uint8_t moves_played() const { return static_cast<std::uint8_t>(popcount(masks[0] | masks[1])); }
+  // unique per position, fits in column_height * columns bits
+  mask_type key() const { return masks[0] + (masks[0] | masks[1]) + bottom_row; }
+  // key() of the position or of its left-right mirror, whichever is smaller
+  mask_type symmetric_key() const
+  {
+    constexpr mask_type column_mask = (mask_type{ 1 } << column_height) - 1;
+    const auto k = key();
+    mask_type mirrored = 0;
+    for (std::uint8_t column = 0; column < columns; ++column) {
+      mirrored |= ((k >> (column * column_height)) & column_mask) << ((columns - 1 - column) * column_height);
+    }
+    return std::min(k, mirrored);
+  }
+  // zobrist hash, kept up to date by every change to the board
+  std::uint64_t hash() const { return zobrist; }
+  // the same for a position and its left-right mirror
+  std::uint64_t canonical_key() const { return std::min(zobrist, mirrored_zobrist); }
   void reset();
 
+  // one mask per color, bit (column * column_height + row) with row 0 at the bottom
+  std::array<mask_type, 2> masks;
+  std::uint64_t zobrist;
+  // hash of the position with the columns mirrored
+  std::uint64_t mirrored_zobrist;
+  // pieces in each column
+  std::array<std::uint8_t, columns> heights;
+  std::array<std::uint8_t, cells> move_stack;
+  std::uint8_t move_stack_size;
 
-  std::array<piece, rows * columns> data;
+private:
+  // flips one cell for a color and updates both hashes, putting and removing a piece are the same operation
+  void toggle_cell(const piece piece, const std::uint8_t column, const std::uint8_t height);
+  // connect pieces in a row along the direction given by shift: 1 is vertical,
+  // column_height horizontal and column_height -/+ 1 the two diagonals
+  constexpr static bool has_alignment(const mask_type mask, const int shift);
 };
 
-module :private;
+export using board = basic_board<6, 7, 4>;
 
-board::board() noexcept { std::fill(data.begin(), data.end(), piece::none); }
-void board::draw_grid(cen::renderer_handle renderer) const
+// variants the game does not play, instantiated at the end of the file so the template and its
+// 128 bit masks keep building; game-test plays them
+static_assert(std::is_same_v<board::mask_type, std::uint64_t>);
+static_assert(std::is_same_v<basic_board<7, 9, 4>::mask_type, wide_mask>);
+static_assert(board::line_count == 69);
+static_assert(basic_board<7, 9, 4>::line_count == 126 && basic_board<9, 7, 5>::line_count == 92);
+static_assert(board::centre_first == std::array<std::uint8_t, 7>{ 3, 2, 4, 1, 5, 0, 6 });
+
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+basic_board<Rows, Columns, ConnectN>::basic_board() noexcept
+{
+  reset();
+}
+
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+void basic_board<Rows, Columns, ConnectN>::draw_grid(cen::renderer_handle renderer) const
 {
   renderer.set_color(cen::colors::black);
   for (auto i = 0; i < rows; ++i) {
@@ -44,134 +230,154 @@ void board::draw_grid(cen::renderer_handle renderer) const
   }
 }
 
-void board::draw_pieces(cen::renderer_handle renderer) const
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+void basic_board<Rows, Columns, ConnectN>::draw_pieces(cen::renderer_handle renderer) const
 {
-  for (std::size_t index = 0; index < data.size(); ++index) {
-    const auto &piece = data[index];
-    if (piece == piece::none) { continue; }
-    const auto x = (index % columns) * cell_size + 50;
-    const auto y = (index / columns) * cell_size + 50;
-    const auto color = piece == piece::red ? cen::colors::red : cen::colors::yellow;
-    renderer.set_color(color);
-    renderer.fill_circle(cen::ipoint{ static_cast<int>(x), static_cast<int>(y) }, 45);
+  for (std::uint8_t row = 0; row < rows; ++row) {
+    for (std::uint8_t column = 0; column < columns; ++column) {
+      const auto piece = at(row, column);
+      if (piece == piece::none) { continue; }
+      const auto x = column * cell_size + 50;
+      const auto y = row * cell_size + 50;
+      const auto color = piece == piece::red ? cen::colors::red : cen::colors::yellow;
+      renderer.set_color(color);
+      renderer.fill_circle(cen::ipoint{ x, y }, 45);
+    }
   }
 }
 
-void board::draw(cen::renderer_handle renderer) const
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+void basic_board<Rows, Columns, ConnectN>::draw(cen::renderer_handle renderer) const
 {
   this->draw_grid(renderer);
   this->draw_pieces(renderer);
 }
 
-void board::put_piece(const piece piece, const std::uint8_t column)
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+auto basic_board<Rows, Columns, ConnectN>::legal_moves() const -> move_list
 {
-  for (std::uint8_t i = rows - 1; i <= rows - 1; --i) {
-    const std::size_t index = i * columns + column;
-    if (data[index] == piece::none) {
-      data[index] = piece;
-      break;
-    }
+  move_list list{};
+  for (std::uint8_t column = 0; column < columns; ++column) {
+    if (can_play(column)) { list.moves[list.size++] = column; }
   }
+  return list;
 }
 
-void board::draw_placeholder(cen::renderer_handle renderer, const cen::ipoint mouse_pos) const
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+std::optional<std::uint8_t> basic_board<Rows, Columns, ConnectN>::put_piece(const piece piece,
+  const std::uint8_t column)
 {
-  const auto [x, y] = mouse_pos.get();
-  const auto column = x / cell_size;
-  const auto row = y / cell_size;
-  assert(std::size_t(row * columns + column) < data.size());
-  const cen::color guide_color{ 0, 255, 55, 100 };
-  const cen::irect guide_rect{ column * cell_size, row * cell_size, cell_size, cell_size };
-  renderer.set_color(guide_color);
-  renderer.fill_rect(guide_rect);
+  assert(column < columns);
+  if (!can_play(column)) { return std::nullopt; }
+  const auto height = heights[column]++;
+  toggle_cell(piece, column, height);
+  return static_cast<std::uint8_t>(rows - 1 - height);
 }
 
-// Checked
-std::uint8_t search_left(std::size_t idx, std::span<piece> data, const piece piece)
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+piece basic_board<Rows, Columns, ConnectN>::remove_piece(const std::uint8_t column)
 {
-  if (idx % board::columns > 0 && data[idx - 1] == piece) {
-    return 1 + search_left(idx - 1, data, piece);
-  } else
-    return 0;
+  assert(column < columns);
+  if (heights[column] == 0) { return piece::none; }
+  const auto height = --heights[column];
+  const auto piece = (masks[0] >> (column * column_height + height)) & 1 ? piece::red : piece::yellow;
+  toggle_cell(piece, column, height);
+  return piece;
 }
 
-std::uint8_t search_right(std::size_t idx, std::span<piece> data, const piece piece)
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+std::optional<std::uint8_t> basic_board<Rows, Columns, ConnectN>::play(const std::uint8_t column)
 {
-  if (idx % board::columns < board::columns - 1 && data[idx + 1] == piece) {
-    return 1 + search_right(idx + 1, data, piece);
-  } else
-    return 0;
+  const auto row = put_piece(to_move(), column);
+  if (row) { move_stack[move_stack_size++] = column; }
+  return row;
 }
 
-std::uint8_t search_up(std::size_t idx, std::span<piece> data, const piece piece)
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN> void basic_board<Rows, Columns, ConnectN>::undo()
 {
-  if (idx / board::columns > 0 && data[idx - board::columns] == piece) {
-    return 1 + search_up(idx - board::columns, data, piece);
-  } else
-    return 0;
+  assert(move_stack_size > 0);
+  remove_piece(move_stack[--move_stack_size]);
 }
 
-std::uint8_t search_down(std::size_t idx, std::span<piece> data, const piece piece)
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+void basic_board<Rows, Columns, ConnectN>::draw_placeholder(cen::renderer_handle renderer,
+  const cen::ipoint mouse_pos) const
 {
-  if (idx / board::columns < board::rows - 1 && data[idx + board::columns] == piece) {
-    return 1 + search_down(idx + board::columns, data, piece);
-  } else
-    return 0;
+  const auto [x, y] = mouse_pos.get();
+  const auto column = x / cell_size;
+  const auto row = y / cell_size;
+  assert(row < rows && column < columns);
+  const cen::color guide_color{ 0, 255, 55, 100 };
+  const cen::irect guide_rect{ column * cell_size, row * cell_size, cell_size, cell_size };
+  renderer.set_color(guide_color);
+  renderer.fill_rect(guide_rect);
 }
 
-std::uint8_t search_up_right(std::size_t idx, std::span<piece> data, const piece piece)
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+bool basic_board<Rows, Columns, ConnectN>::check_winner(const piece piece) const
 {
-  // upright should avoid last column and first row
-  if (idx % board::columns < board::columns - 1 && idx / board::rows > 0 && data[idx - board::columns + 1] == piece) {
-    return 1 + search_up_right(idx - board::columns + 1, data, piece);
-  } else
-    return 0;
+  const auto mask = masks[mask_index(piece)];
+  return has_alignment(mask, 1) or has_alignment(mask, column_height) or has_alignment(mask, column_height - 1)
+         or has_alignment(mask, column_height + 1);
 }
-std::uint8_t search_up_left(std::size_t idx, std::span<piece> data, const piece piece)
+
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+bool basic_board<Rows, Columns, ConnectN>::check_winner_at(const std::uint8_t row, const std::uint8_t column) const
 {
-  // upleft should avoid first column and first row
-  if (idx % board::columns > 0 && idx / board::columns > 0 && data[idx - board::columns - 1] == piece) {
-    return 1 + search_up_left(idx - board::columns - 1, data, piece);
-  } else
-    return 0;
+  const auto piece = at(row, column);
+  if (piece == piece::none) { return false; }
+  const auto mask = masks[mask_index(piece)];
+  for (const auto index : cell_lines[bit_index(column, static_cast<std::uint8_t>(rows - 1 - row))]) {
+    if ((mask & lines[index]) == lines[index]) { return true; }
+  }
+  return false;
 }
 
-std::uint8_t search_down_right(std::size_t idx, std::span<piece> data, const piece piece)
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+piece basic_board<Rows, Columns, ConnectN>::at(const std::uint8_t row, const std::uint8_t column) const
 {
-  // downright should avoid last column and last row
-  if (idx % board::columns < board::columns - 1 && idx / board::columns < board::rows - 1
-      && data[idx + board::columns + 1] == piece) {
-    return 1 + search_down_right(idx + board::columns + 1, data, piece);
-  } else
-    return 0;
+  assert(row < rows && column < columns);
+  const auto cell = mask_type{ 1 } << (column * column_height + (rows - 1 - row));
+  if (masks[0] & cell) { return piece::red; }
+  if (masks[1] & cell) { return piece::yellow; }
+  return piece::none;
 }
-std::uint8_t search_down_left(std::size_t idx, std::span<piece> data, const piece piece)
+
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN> void basic_board<Rows, Columns, ConnectN>::reset()
 {
-  // downright should avoid first column and last row
-  if (idx % board::columns > 0 && idx / board::columns < board::rows - 1 && data[idx + board::columns - 1] == piece) {
-    return 1 + search_down_right(idx + board::columns - 1, data, piece);
-  } else
-    return 0;
+  masks.fill(0);
+  zobrist = 0;
+  mirrored_zobrist = 0;
+  heights.fill(0);
+  move_stack_size = 0;
 }
 
-bool board::check_winner(const piece piece)
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+void basic_board<Rows, Columns, ConnectN>::toggle_cell(const piece piece,
+  const std::uint8_t column,
+  const std::uint8_t height)
 {
-  for (std::size_t index = 0; index < data.size(); ++index) {
-    if (data[index] != piece) { continue; }
-    // we start in 1 because we are counting the selected one
-    std::uint8_t count_horizontal = 1 + search_left(index, this->data, piece) + search_right(index, this->data, piece);
-    std::uint8_t count_vertical = 1 + search_down(index, this->data, piece) + search_up(index, this->data, piece);
-    std::uint8_t count_diagonal_down_to_up =
-      1 + search_down_left(index, data, piece) + search_up_right(index, data, piece);
-    std::uint8_t count_diagonal_up_to_down =
-      1 + search_up_left(index, data, piece) + search_down_right(index, data, piece);
+  const auto color = mask_index(piece);
+  const auto bit = bit_index(column, height);
+  const auto mirrored_bit = bit_index(static_cast<std::uint8_t>(columns - 1 - column), height);
+  masks[color] ^= mask_type{ 1 } << bit;
+  zobrist ^= zobrist_keys[color][bit];
+  mirrored_zobrist ^= zobrist_keys[color][mirrored_bit];
+}
 
-    if (count_horizontal > 3 or count_vertical > 3 or count_diagonal_down_to_up > 3 or count_diagonal_up_to_down > 3) {
-      return true;
-    }
+template<std::uint8_t Rows, std::uint8_t Columns, std::uint8_t ConnectN>
+constexpr bool basic_board<Rows, Columns, ConnectN>::has_alignment(const mask_type mask, const int shift)
+{
+  // double the run length while it fits, then overlap two runs to reach exactly connect
+  auto run = mask;
+  int length = 1;
+  while (length * 2 <= connect) {
+    run &= run >> (length * shift);
+    length *= 2;
   }
-
-
-  return false;
+  if (length < connect) { run &= run >> ((connect - length) * shift); }
+  return run != 0;
 }
-void board::reset() { std::fill(data.begin(), data.end(), piece::none); }
+
+template struct basic_board<7, 9, 4>;
+template struct basic_board<9, 7, 5>;
@@ -0,0 +1,101 @@
+module;
+#include <array>
+#include <cstdint>
+export module evaluation;
+import board;
+
+// points for a line holding n pieces of one side and none of the other
+template<std::uint8_t Connect> constexpr auto line_points = [] {
+  std::array<int, Connect + 1> points{};
+  for (int n = 1; n < Connect; ++n) { points[n] = n * n; }
+  return points;
+}();
+// per empty cell that would complete a line, and extra when it sits on a row that side gets in the end:
+// with the rest of the board filled up alternately the first player fills the odd rows, counted from
+// the bottom, and the second player the even ones
+constexpr int threat_points = 12;
+constexpr int parity_points = 12;
+
+// Static score from the side to move, positive is good for it: every line free of the opponent
+// scores by how full it is, and each open three (an empty cell that would complete a line) scores
+// on top, more so when its row parity favours its owner. Walks the line table once with a popcount
+// per side, evaluate_threats_reference below gives the same numbers cell by cell.
+export template<typename Board> int evaluate_threats(const Board &position)
+{
+  using mask_type = typename Board::mask_type;
+  constexpr auto &points = line_points<Board::connect>;
+  // heights 0, 2, 4... are the odd rows counted from 1 at the bottom
+  constexpr mask_type odd_rows = [] {
+    mask_type mask = 0;
+    for (int height = 0; height < Board::rows; height += 2) { mask |= Board::bottom_row << height; }
+    return mask;
+  }();
+  constexpr mask_type even_rows = (Board::bottom_row * ((mask_type{ 1 } << Board::rows) - 1)) & ~odd_rows;
+
+  const auto red = position.masks[0];
+  const auto yellow = position.masks[1];
+  const auto empty = ~(red | yellow);
+  std::array<int, 2> score{};
+  std::array<mask_type, 2> threats{};
+  for (const auto line : Board::lines) {
+    const int reds = popcount(line & red);
+    const int yellows = popcount(line & yellow);
+    if (yellows == 0) {
+      score[0] += points[reds];
+      if (reds == Board::connect - 1) { threats[0] |= line & empty; }
+    } else if (reds == 0) {
+      score[1] += points[yellows];
+      if (yellows == Board::connect - 1) { threats[1] |= line & empty; }
+    }
+  }
+  score[0] += threat_points * popcount(threats[0]) + parity_points * popcount(threats[0] & odd_rows);
+  score[1] += threat_points * popcount(threats[1]) + parity_points * popcount(threats[1] & even_rows);
+  const int red_score = score[0] - score[1];
+  return position.to_move() == piece::red ? red_score : -red_score;
+}
+
+// evaluate_threats one cell at a time through at(), slow but easy to check by hand
+export template<typename Board> int evaluate_threats_reference(const Board &position)
+{
+  constexpr auto &points = line_points<Board::connect>;
+  std::array<int, 2> score{};
+  // [side][height][column], height 0 at the bottom
+  std::array<std::array<std::array<bool, Board::columns>, Board::rows>, 2> threat{};
+  constexpr std::array<std::array<int, 2>, 4> directions{ { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, -1 } } };
+  for (const auto [column_step, height_step] : directions) {
+    for (int column = 0; column < Board::columns; ++column) {
+      for (int height = 0; height < Board::rows; ++height) {
+        const int last_column = column + (Board::connect - 1) * column_step;
+        const int last_height = height + (Board::connect - 1) * height_step;
+        if (last_column >= Board::columns || last_height < 0 || last_height >= Board::rows) { continue; }
+        std::array<int, 2> pieces{};
+        int empty_column = 0;
+        int empty_height = 0;
+        for (int i = 0; i < Board::connect; ++i) {
+          const int c = column + i * column_step;
+          const int h = height + i * height_step;
+          const auto p = position.at(static_cast<std::uint8_t>(Board::rows - 1 - h), static_cast<std::uint8_t>(c));
+          if (p == piece::none) {
+            empty_column = c;
+            empty_height = h;
+          } else {
+            ++pieces[p == piece::red ? 0 : 1];
+          }
+        }
+        for (int side = 0; side < 2; ++side) {
+          if (pieces[1 - side] != 0) { continue; }
+          score[side] += points[pieces[side]];
+          if (pieces[side] == Board::connect - 1) { threat[side][empty_height][empty_column] = true; }
+        }
+      }
+    }
+  }
+  for (int height = 0; height < Board::rows; ++height) {
+    for (int column = 0; column < Board::columns; ++column) {
+      if (threat[0][height][column]) { score[0] += threat_points + (height % 2 == 0 ? parity_points : 0); }
+      if (threat[1][height][column]) { score[1] += threat_points + (height % 2 == 1 ? parity_points : 0); }
+    }
+  }
+  const int red_score = score[0] - score[1];
+  return position.to_move() == piece::red ? red_score : -red_score;
+}
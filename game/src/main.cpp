@@ -1,6 +1,8 @@
 import rooster;
+import ai_player;
 import board;
 import setup;
+#include <algorithm>
 #include <string_view>
 #include <cassert>
 
@@ -11,9 +13,17 @@ auto make_text(cen::renderer_handle &ren,
 {
   return ren.make_texture(font.render_blended(text.data(), color));
 }
-void render_system(ginseng::database &reg)
+// the per frame visits go through cached queries, which only hold the entities that match; they are
+// made before the game runs, creating one changes the registry and systems only touch what they declare
+struct game_queries
 {
-  reg.visit([&](ginseng::database::ent_id id, rooster::game_tag) {
+  const ginseng::query<ginseng::database::ent_id, rooster::game_tag> &games;
+  const ginseng::query<input_state> &inputs;
+};
+
+void render_system(ginseng::database &reg, const game_queries &queries)
+{
+  reg.visit(queries.games, [&](ginseng::database::ent_id id, rooster::game_tag) {
     assert(reg.has_component<board>(id));
     assert(reg.has_component<cen::renderer_handle>(id));
     assert(reg.has_component<game_state>(id));
@@ -44,14 +54,14 @@ void render_system(ginseng::database &reg)
     if (state.game_over) {
       draw_gameover_screen();
     } else {
-      reg.visit([&](input_state &state) { b.draw_placeholder(ren, state.mouse_pos); });
+      reg.visit(queries.inputs, [&](input_state &state) { b.draw_placeholder(ren, state.mouse_pos); });
     }
     ren.present();
   });
 }
-void update_system(ginseng::database &reg)
+void update_system(ginseng::database &reg, const game_queries &queries)
 {
-  reg.visit([&](ginseng::database::ent_id id, rooster::game_tag) {
+  reg.visit(queries.games, [&](ginseng::database::ent_id id, rooster::game_tag) {
     auto on_quit = [&]() {
       auto &flow = reg.get_component<rooster::gameflow>(id);
       flow = rooster::gameflow::stop;
@@ -60,26 +70,43 @@ void update_system(ginseng::database &reg)
     assert(reg.has_component<game_state>(id));
     assert(reg.has_component<input_state>(id));
     assert(reg.has_component<board>(id));
+    assert(reg.has_component<ai_player>(id));
     auto &handler = reg.get_component<cen::event_handler>(id);
     auto &state = reg.get_component<game_state>(id);
     auto &input = reg.get_component<input_state>(id);
     auto &b = reg.get_component<board>(id);
+    auto &ai = reg.get_component<ai_player>(id);
+
+    auto play = [&](const std::uint8_t x) {
+      const auto row = b.put_piece(state.turn == turn_for::player1 ? piece::red : piece::yellow, x);
+      state.game_over = b.check_winner_at(*row, x);
+      if (state.game_over) {
+        ai.cancel();
+        return;
+      }
+      state.turn = state.turn == turn_for::player1 ? turn_for::player2 : turn_for::player1;
+      // the ai thinks on its own thread, its move shows up in a later frame
+      if (state.turn == turn_for::player2 && b.moves_played() < board::cells) ai.start(b);
+    };
 
     auto on_mouse_down = [&](const auto &event) {
+      // only the last move is checked for a win, a click after it must not play on
+      if (state.game_over) return;
       if (!event.pressed()) return;
       if (event.button() != cen::mouse_button::left) return;
+      if (state.turn == turn_for::player2) return;
 
-      auto x = event.x() / 100;
-      b.put_piece(state.turn == turn_for::player1 ? piece::red : piece::yellow, static_cast<std::uint8_t>(x));
-      state.game_over = b.check_winner(state.turn == turn_for::player1 ? piece::red : piece::yellow);
-      if (state.game_over) return;
-      state.turn = state.turn == turn_for::player1 ? turn_for::player2 : turn_for::player1;
+      const auto x = static_cast<std::uint8_t>(event.x() / board::cell_size);
+      // a full column is not a move, keep the turn
+      if (!b.can_play(x)) return;
+      play(x);
     };
 
     auto on_mouse_move = [&](const auto &event) { input.mouse_pos = { event.x(), event.y() }; };
 
     auto on_key_down = [&](const auto &event) {
       if (event.pressed() and event.key() == cen::keycodes::r) {
+        ai.cancel();
         b.reset();
         state.game_over = false;
         state.turn = turn_for::player1;
@@ -97,6 +124,12 @@ void update_system(ginseng::database &reg)
         on_key_down(handler.get<cen::keyboard_event>());
       }
     }
+    if (const auto x = ai.poll()) play(*x);
+    // the human's time is the ai's too, the hovered column is the likeliest reply
+    if (!state.game_over && state.turn == turn_for::player1 && b.moves_played() < board::cells) {
+      const auto [x, y] = input.mouse_pos.get();
+      ai.ponder(b, static_cast<std::uint8_t>(std::clamp(x / board::cell_size, 0, board::columns - 1)));
+    }
   });
 }
 
@@ -107,10 +140,25 @@ int main(int, char *[])
   const cen::ttf ttf;// Init SDL_ttf
   const cen::mix mix;// Init SDL_mixer
 
-  rooster::game("Connect Four", cen::iarea{ 700, 600 })
+  rooster::game game("Connect Four", cen::iarea{ 700, 600 });
+  auto &reg = game.get_registry();
+  const game_queries queries{
+    reg.get_query<ginseng::database::ent_id, rooster::game_tag>(),
+    reg.get_query<input_state>(),
+  };
+  game
     .add_setup_callback(startup)
-    .add_system(update_system)
-    .add_system(render_system)
+    // both talk to SDL, and render needs the frame update made, so they still run one after the other
+    .add_system("update",
+      [&](ginseng::database &db) { update_system(db, queries); },
+      rooster::reads<rooster::game_tag>{},
+      rooster::writes<cen::event_handler, game_state, input_state, board, ai_player, rooster::gameflow>{},
+      rooster::system_thread::main)
+    .add_system("render",
+      [&](ginseng::database &db) { render_system(db, queries); },
+      rooster::reads<rooster::game_tag, board, game_state, input_state, cen::font>{},
+      rooster::writes<cen::renderer_handle>{},
+      rooster::system_thread::main)
     .run();
   return 0;
 }
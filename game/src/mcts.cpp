@@ -0,0 +1,252 @@
+module;
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+export module mcts;
+import board;
+import rooster;
+
+export struct mcts_limits
+{
+  std::int64_t time_ms = 1000;
+  // 0 means only the clock stops the search
+  std::uint64_t max_playouts = 0;
+  // more than one runs tree parallel, all threads growing the same tree
+  std::uint8_t threads = 1;
+};
+
+export struct mcts_report
+{
+  // the root move played out most often
+  std::uint8_t best_move;
+  // of best_move for the side to move, draws count half
+  double win_rate;
+  std::uint64_t playouts;
+  std::int64_t elapsed_ms;
+  double playouts_per_second;
+  std::size_t tree_nodes;
+  std::size_t tree_bytes;
+};
+
+// Monte Carlo tree search with UCT selection and random playouts, for boards too big to solve.
+// Nodes come out of one arena allocated up front, a search that fills it keeps playing out from
+// the leaves it has. With more than one thread every thread walks the same tree, and a thread
+// going down a node adds a virtual loss to it until its playout is back, so the others spread out.
+export template<typename Board> class basic_mcts
+{
+public:
+  // the arena size, a node takes about 20 bytes
+  explicit basic_mcts(std::size_t memory_mb = 64)
+    : m_capacity(memory_mb * 1024 * 1024 / sizeof(node)), m_nodes(std::make_unique<node[]>(m_capacity))
+  {}
+
+  // the position must have a legal move and no winner yet
+  mcts_report search(const Board &position, const mcts_limits &limits)
+  {
+    m_start = now();
+    m_limits = limits;
+    m_playouts.store(0, std::memory_order_relaxed);
+    m_stop.store(false, std::memory_order_relaxed);
+    m_full.store(false, std::memory_order_relaxed);
+    m_used.store(1, std::memory_order_relaxed);
+    init(m_nodes[0], 0);
+
+    {
+      std::vector<std::jthread> threads;
+      for (std::uint8_t i = 1; i < limits.threads; ++i) {
+        threads.emplace_back([this, &position, i] { run(position, 0x9e37'79b9'7f4a'7c15 * (i + 1)); });
+      }
+      run(position, 0x2545'f491'4f6c'dd1d);
+    }
+
+    const auto &root = m_nodes[0];
+    const node *best = nullptr;
+    for (std::uint8_t i = 0; i < root.child_count; ++i) {
+      const auto &child = m_nodes[root.first_child.load(std::memory_order_relaxed) + i];
+      if (!best || child.visits.load(std::memory_order_relaxed) > best->visits.load(std::memory_order_relaxed)) {
+        best = &child;
+      }
+    }
+    const auto playouts = m_playouts.load(std::memory_order_relaxed);
+    const auto ms = elapsed(m_start);
+    const auto visits = best ? best->visits.load(std::memory_order_relaxed) : 0;
+    const auto used = m_used.load(std::memory_order_relaxed);
+    const auto tree_nodes = used < m_capacity ? used : m_capacity;
+    return {
+      best ? best->move : Board::centre_first[0],
+      visits > 0 ? best->score.load(std::memory_order_relaxed) / (2.0 * visits) : 0.5,
+      playouts,
+      ms,
+      static_cast<double>(playouts) * 1000.0 / static_cast<double>(ms > 0 ? ms : 1),
+      tree_nodes,
+      tree_nodes * sizeof(node),
+    };
+  }
+
+  std::size_t capacity() const { return m_capacity; }
+
+private:
+  enum node_state : std::uint8_t { leaf, expanding, expanded };
+
+  struct node
+  {
+    std::atomic<std::uint32_t> visits;
+    // half points for the side that played move, 2 a win and 1 a draw
+    std::atomic<std::uint32_t> score;
+    // threads below this node right now
+    std::atomic<std::uint32_t> virtual_loss;
+    // children are contiguous in the arena, only valid once state is expanded
+    std::atomic<std::uint32_t> first_child;
+    std::atomic<node_state> state;
+    std::uint8_t child_count;
+    std::uint8_t move;
+  };
+
+  // a leaf grows its children on its second visit, so single playout leaves stay cheap
+  constexpr static std::uint32_t expand_visits = 2;
+  constexpr static double exploration = 1.41421356;
+
+  static void init(node &n, std::uint8_t move)
+  {
+    n.visits.store(0, std::memory_order_relaxed);
+    n.score.store(0, std::memory_order_relaxed);
+    n.virtual_loss.store(0, std::memory_order_relaxed);
+    n.first_child.store(0, std::memory_order_relaxed);
+    n.state.store(leaf, std::memory_order_relaxed);
+    n.child_count = 0;
+    n.move = move;
+  }
+
+  static std::uint64_t next_random(std::uint64_t &state)
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+
+  void run(const Board &position, std::uint64_t random)
+  {
+    std::uint64_t local = 0;
+    while (!m_stop.load(std::memory_order_relaxed)) {
+      playout(position, random);
+      const auto total = m_playouts.fetch_add(1, std::memory_order_relaxed) + 1;
+      if (m_limits.max_playouts != 0 && total >= m_limits.max_playouts) { m_stop.store(true, std::memory_order_relaxed); }
+      // the clock is not free, only look at it every few hundred playouts
+      if ((++local & 255) == 0 && elapsed(m_start) >= m_limits.time_ms) { m_stop.store(true, std::memory_order_relaxed); }
+    }
+  }
+
+  // false when another thread is already expanding it or the arena is full
+  bool expand(node &n, const Board &position)
+  {
+    if (m_full.load(std::memory_order_relaxed)) { return false; }
+    auto state = leaf;
+    if (!n.state.compare_exchange_strong(state, expanding, std::memory_order_acquire)) { return false; }
+    const auto moves = position.legal_moves();
+    const auto first = m_used.fetch_add(moves.size, std::memory_order_relaxed);
+    if (first + moves.size > m_capacity) {
+      m_full.store(true, std::memory_order_relaxed);
+      n.state.store(leaf, std::memory_order_release);
+      return false;
+    }
+    for (std::uint8_t i = 0; i < moves.size; ++i) { init(m_nodes[first + i], moves.moves[i]); }
+    n.child_count = moves.size;
+    n.first_child.store(static_cast<std::uint32_t>(first), std::memory_order_relaxed);
+    n.state.store(expanded, std::memory_order_release);
+    return true;
+  }
+
+  node &select(const node &parent)
+  {
+    // virtual losses count as visits that scored nothing
+    const auto parent_visits = parent.visits.load(std::memory_order_relaxed) + parent.virtual_loss.load(std::memory_order_relaxed);
+    const double log_visits = std::log(static_cast<double>(parent_visits > 0 ? parent_visits : 1));
+    const auto first = parent.first_child.load(std::memory_order_relaxed);
+    node *best = &m_nodes[first];
+    double best_value = -1;
+    for (std::uint8_t i = 0; i < parent.child_count; ++i) {
+      auto &child = m_nodes[first + i];
+      const auto visits = child.visits.load(std::memory_order_relaxed) + child.virtual_loss.load(std::memory_order_relaxed);
+      if (visits == 0) { return child; }
+      const double n = static_cast<double>(visits);
+      const double value =
+        child.score.load(std::memory_order_relaxed) / (2.0 * n) + exploration * std::sqrt(log_visits / n);
+      if (value > best_value) {
+        best_value = value;
+        best = &child;
+      }
+    }
+    return *best;
+  }
+
+  // one selection, expansion, random playout and backup
+  void playout(const Board &position, std::uint64_t &random)
+  {
+    auto scratch = position;
+    std::array<node *, Board::cells + 1> path;
+    std::array<piece, Board::cells + 1> movers;
+    std::uint8_t length = 0;
+    auto *current = &m_nodes[0];
+    current->virtual_loss.fetch_add(1, std::memory_order_relaxed);
+    path[length] = current;
+    movers[length++] = piece::none;
+
+    auto winner = piece::none;
+    bool over = false;
+    while (!over) {
+      if (current->state.load(std::memory_order_acquire) != expanded) {
+        const bool grow = current == &m_nodes[0] || current->visits.load(std::memory_order_relaxed) + 1 >= expand_visits;
+        if (!grow || !expand(*current, scratch)) { break; }
+      }
+      current = &select(*current);
+      current->virtual_loss.fetch_add(1, std::memory_order_relaxed);
+      const auto mover = scratch.to_move();
+      path[length] = current;
+      movers[length++] = mover;
+      const auto row = scratch.play(current->move);
+      if (scratch.check_winner_at(*row, current->move)) {
+        winner = mover;
+        over = true;
+      } else if (scratch.moves_played() == Board::cells) {
+        over = true;
+      }
+    }
+
+    // random moves on the bitboards until someone connects or the board is full
+    while (!over && scratch.moves_played() < Board::cells) {
+      const auto moves = scratch.legal_moves();
+      const auto column = moves.moves[next_random(random) % moves.size];
+      const auto mover = scratch.to_move();
+      const auto row = scratch.play(column);
+      if (scratch.check_winner_at(*row, column)) {
+        winner = mover;
+        over = true;
+      }
+    }
+
+    for (std::uint8_t i = 0; i < length; ++i) {
+      auto &n = *path[i];
+      n.visits.fetch_add(1, std::memory_order_relaxed);
+      n.score.fetch_add(winner == piece::none ? 1 : (winner == movers[i] ? 2 : 0), std::memory_order_relaxed);
+      n.virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::size_t m_capacity;
+  std::unique_ptr<node[]> m_nodes;
+  std::atomic<std::size_t> m_used = 0;
+  std::atomic<bool> m_full = false;
+  std::atomic<std::uint64_t> m_playouts = 0;
+  std::atomic<bool> m_stop = false;
+  std::chrono::steady_clock::time_point m_start;
+  mcts_limits m_limits;
+};
+
+export using mcts = basic_mcts<board>;
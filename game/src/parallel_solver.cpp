@@ -0,0 +1,400 @@
+module;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+export module parallel_solver;
+import board;
+import rooster;
+import solver;
+import transposition_table;
+
+// Chase-Lev work-stealing deque of pointers: the owner pushes and pops at the bottom like a
+// stack, any other thread steals from the top. Fixed capacity, push fails instead of growing.
+export template<typename T, std::size_t Capacity> class chase_lev_deque
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+  // owner only, false when full
+  bool push(T *item)
+  {
+    const auto bottom = m_bottom.load(std::memory_order_relaxed);
+    const auto top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= static_cast<std::int64_t>(Capacity)) { return false; }
+    m_items[bottom & mask].store(item, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  // owner only, newest item first, nullptr when empty
+  T *pop()
+  {
+    const auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = m_top.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T *item = m_items[bottom & mask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // last item, race the thieves for it
+      if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // any thread, oldest item first, nullptr when empty or when another thread won the race
+  T *steal()
+  {
+    auto top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom) { return nullptr; }
+    T *item = m_items[top & mask].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+private:
+  constexpr static std::int64_t mask = Capacity - 1;
+
+  alignas(64) std::atomic<std::int64_t> m_top = 0;
+  alignas(64) std::atomic<std::int64_t> m_bottom = 0;
+  std::array<std::atomic<T *>, Capacity> m_items{};
+};
+
+// what one thread did, summed over every search since the last reset
+export struct worker_stats
+{
+  std::uint64_t nodes;
+  // subtrees run, stolen or not
+  std::uint64_t tasks;
+  std::uint64_t steals;
+  // steal attempts that found an empty deque or lost a race
+  std::uint64_t failed_steals;
+  // time spent with no task to run
+  double idle_seconds;
+  tt_stats table;
+};
+
+// Exact solver for trees too big for one thread, same scores as solver. The tree is split with
+// the young brothers wait concept: a node searches its first child alone, and only when that
+// did not cut off are the remaining children pushed as tasks on the thread's deque, where idle
+// threads steal them. The owner helps with any task it can find until all its children are done.
+// Siblings share the node's alpha, and the first one to fail high cuts off the rest.
+// Nodes with few empty cells left are never split, tasks that small cost more than they save.
+export class parallel_solver
+{
+public:
+  // 0 threads means one per hardware thread, the table is shared by all of them
+  explicit parallel_solver(transposition_table &table, std::uint8_t threads = 0, std::uint8_t min_split_depth = 14);
+  // exact score, the position must not be already won
+  solver_result solve(const board &position);
+  // alpha-beta search in the window [alpha, beta]
+  solver_result search(const board &position, int alpha, int beta);
+
+  std::size_t threads() const { return m_workers.size(); }
+  // per thread, the first one is the thread calling search
+  std::vector<worker_stats> stats() const;
+  std::uint64_t nodes() const;
+  double nodes_per_second() const;
+  void reset_stats();
+
+private:
+  struct split_point;
+
+  // a child of a split point, lives on the stack of the thread that split
+  struct task
+  {
+    split_point *parent;
+    std::uint8_t column;
+  };
+
+  struct split_point
+  {
+    board position;
+    int beta;
+    // the nearest split point above, its cutoff stops this one too
+    split_point *parent;
+    // best score * 256 + its move, the score part is the siblings' shared alpha
+    std::atomic<int> best;
+    std::atomic<bool> cutoff;
+    // children not finished yet, the owner waits for 0
+    std::atomic<int> pending;
+    std::array<task, board::columns> tasks;
+  };
+
+  struct worker
+  {
+    chase_lev_deque<task, 512> deque;
+    worker_stats stats{};
+    std::uint64_t random;
+    // the current task was cut off from above, every node returns at once
+    bool stopped = false;
+  };
+
+  // runs body on the calling thread while the other workers help, they live until it returns
+  template<typename Body> solver_result with_helpers(Body &&body);
+  // the calling thread's part of one search, with_helpers provides the rest
+  solver_result search_root(const board &position, int alpha, int beta);
+  static int best_score(int best) { return (best - (best & 0xff)) / 256; }
+  static std::uint8_t best_move(int best) { return static_cast<std::uint8_t>(best & 0xff); }
+  // a steal target only, never the own deque
+  task *steal(worker &self);
+  // runs one task, own ones first, or idles for a moment when there is none
+  void help(worker &self);
+  void run(worker &self, task &job);
+  // true when any split point from here to the root has been cut off
+  static bool cut_off(const split_point *split);
+  int negamax(worker &self, board &position, int alpha, int beta, split_point *parent);
+
+  transposition_table &m_table;
+  std::uint8_t m_min_split_depth;
+  std::vector<std::unique_ptr<worker>> m_workers;
+  double m_seconds = 0;
+};
+
+module :private;
+
+parallel_solver::parallel_solver(transposition_table &table, std::uint8_t threads, std::uint8_t min_split_depth)
+  : m_table(table), m_min_split_depth(min_split_depth)
+{
+  const std::size_t count = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t i = 0; i < count; ++i) {
+    m_workers.push_back(std::make_unique<worker>());
+    m_workers.back()->random = 0x9e37'79b9'7f4a'7c15 * (i + 1);
+  }
+}
+
+solver_result parallel_solver::solve(const board &position)
+{
+  // one set of threads for all the null window searches, they idle in between
+  return with_helpers([&] {
+    return null_window_solve(
+      position.moves_played(), [&](int alpha, int beta) { return search_root(position, alpha, beta); });
+  });
+}
+
+solver_result parallel_solver::search(const board &position, int alpha, int beta)
+{
+  return with_helpers([&] { return search_root(position, alpha, beta); });
+}
+
+template<typename Body> solver_result parallel_solver::with_helpers(Body &&body)
+{
+  const auto start = now();
+  std::atomic<bool> done = false;
+  std::vector<std::jthread> threads;
+  for (std::size_t i = 1; i < m_workers.size(); ++i) {
+    threads.emplace_back([this, &done, &self = *m_workers[i]] {
+      while (!done.load(std::memory_order_acquire)) { help(self); }
+    });
+  }
+  const auto result = body();
+  done.store(true, std::memory_order_release);
+  threads.clear();
+  m_seconds += std::chrono::duration<double>(now() - start).count();
+  return result;
+}
+
+solver_result parallel_solver::search_root(const board &position, int alpha, int beta)
+{
+  auto scratch = position;
+  return { negamax(*m_workers[0], scratch, alpha, beta, nullptr), true };
+}
+
+std::vector<worker_stats> parallel_solver::stats() const
+{
+  std::vector<worker_stats> stats;
+  for (const auto &w : m_workers) { stats.push_back(w->stats); }
+  return stats;
+}
+
+std::uint64_t parallel_solver::nodes() const
+{
+  std::uint64_t nodes = 0;
+  for (const auto &w : m_workers) { nodes += w->stats.nodes; }
+  return nodes;
+}
+
+double parallel_solver::nodes_per_second() const
+{
+  return m_seconds > 0 ? static_cast<double>(nodes()) / m_seconds : 0;
+}
+
+void parallel_solver::reset_stats()
+{
+  for (auto &w : m_workers) { w->stats = {}; }
+  m_seconds = 0;
+}
+
+parallel_solver::task *parallel_solver::steal(worker &self)
+{
+  const auto count = m_workers.size();
+  if (count < 2) { return nullptr; }
+  // xorshift, a random first victim keeps the thieves from all queuing on the same deque
+  self.random ^= self.random << 13;
+  self.random ^= self.random >> 7;
+  self.random ^= self.random << 17;
+  const auto first = self.random % count;
+  for (std::size_t i = 0; i < count; ++i) {
+    auto &victim = *m_workers[(first + i) % count];
+    if (&victim == &self) { continue; }
+    if (auto *job = victim.deque.steal()) {
+      ++self.stats.steals;
+      return job;
+    }
+    ++self.stats.failed_steals;
+  }
+  return nullptr;
+}
+
+void parallel_solver::help(worker &self)
+{
+  auto *job = self.deque.pop();
+  if (!job) { job = steal(self); }
+  if (job) {
+    run(self, *job);
+    return;
+  }
+  const auto start = now();
+  std::this_thread::yield();
+  self.stats.idle_seconds += std::chrono::duration<double>(now() - start).count();
+}
+
+void parallel_solver::run(worker &self, task &job)
+{
+  auto &split = *job.parent;
+  ++self.stats.tasks;
+  // a task can run while this thread waits on its own split point, whose state must survive it
+  const bool was_stopped = self.stopped;
+  self.stopped = false;
+  const int alpha = best_score(split.best.load(std::memory_order_acquire));
+  if (alpha < split.beta && !cut_off(&split)) {
+    auto position = split.position;
+    position.play(job.column);
+    const int score = -negamax(self, position, -split.beta, -alpha, &split);
+    // anything at or below the alpha it started with is only a bound, and never better than the shared alpha
+    if (!self.stopped && score > alpha) {
+      const int packed = score * 256 + job.column;
+      auto best = split.best.load(std::memory_order_relaxed);
+      while (best_score(best) < score && !split.best.compare_exchange_weak(best, packed, std::memory_order_acq_rel)) {}
+      if (score >= split.beta) { split.cutoff.store(true, std::memory_order_release); }
+    }
+  }
+  self.stopped = was_stopped;
+  split.pending.fetch_sub(1, std::memory_order_release);
+}
+
+bool parallel_solver::cut_off(const split_point *split)
+{
+  for (; split; split = split->parent) {
+    if (split->cutoff.load(std::memory_order_relaxed)) { return true; }
+  }
+  return false;
+}
+
+int parallel_solver::negamax(worker &self, board &position, int alpha, int beta, split_point *parent)
+{
+  // walking up the split points is not free, only look every few dozen nodes
+  if ((++self.stats.nodes & 63) == 0 && cut_off(parent)) { self.stopped = true; }
+  if (self.stopped) { return 0; }
+  const int moves = position.moves_played();
+  if (moves == board::cells) { return 0; }
+
+  for (const auto column : position.legal_moves()) {
+    const auto row = position.play(column);
+    const bool wins = position.check_winner_at(*row, column);
+    position.undo();
+    if (wins) { return (board::cells + 1 - moves) / 2; }
+  }
+
+  // we cannot win right now, so the best we can hope for is winning with our next piece
+  const int max = (board::cells - 1 - moves) / 2;
+  if (beta > max) {
+    beta = max;
+    if (alpha >= beta) { return beta; }
+  }
+
+  std::uint8_t table_move = board::centre_first[0];
+  const auto key = position.key();
+  const auto depth = static_cast<std::uint8_t>(board::cells - moves);
+  if (const auto entry = m_table.probe(key, self.stats.table)) {
+    table_move = entry->move;
+    if (entry->depth >= depth) {
+      if (entry->bound == tt_bound::exact) { return entry->score; }
+      if (entry->bound == tt_bound::upper && beta > entry->score) {
+        beta = entry->score;
+      } else if (entry->bound == tt_bound::lower && alpha < entry->score) {
+        alpha = entry->score;
+      }
+      if (alpha >= beta) { return alpha; }
+    }
+  }
+
+  // the table's move first, then the rest centre first
+  std::array<std::uint8_t, board::columns> order{};
+  std::uint8_t count = 0;
+  if (position.can_play(table_move)) { order[count++] = table_move; }
+  for (const auto column : board::centre_first) {
+    if (column != table_move && position.can_play(column)) { order[count++] = column; }
+  }
+
+  const int alpha_start = alpha;
+  auto best_move = order[0];
+  // the eldest brother alone, the others only run in parallel once it has not cut off
+  std::uint8_t next = 0;
+  while (next < count && (next == 0 || depth <= m_min_split_depth)) {
+    const auto column = order[next++];
+    position.play(column);
+    const int score = -negamax(self, position, -beta, -alpha, parent);
+    position.undo();
+    if (self.stopped) { return 0; }
+    if (score >= beta) {
+      m_table.store(key, { tt_bound::lower, static_cast<std::int16_t>(score), column, depth });
+      return score;
+    }
+    if (score > alpha) {
+      alpha = score;
+      best_move = column;
+    }
+  }
+
+  if (next < count) {
+    split_point split{ position, beta, parent, alpha * 256 + best_move, false, count - next, {} };
+    // pushed worst first, so the owner pops the most promising ones and thieves take the rest
+    for (std::uint8_t i = count; i-- > next;) {
+      split.tasks[i] = { &split, order[i] };
+      if (!self.deque.push(&split.tasks[i])) { run(self, split.tasks[i]); }
+    }
+    while (split.pending.load(std::memory_order_acquire) > 0) { help(self); }
+    if (cut_off(parent)) {
+      self.stopped = true;
+      return 0;
+    }
+    const auto best = split.best.load(std::memory_order_acquire);
+    best_move = parallel_solver::best_move(best);
+    if (split.cutoff.load(std::memory_order_relaxed)) {
+      m_table.store(key, { tt_bound::lower, static_cast<std::int16_t>(best_score(best)), best_move, depth });
+      return best_score(best);
+    }
+    alpha = best_score(best);
+  }
+
+  const auto bound = alpha > alpha_start ? tt_bound::exact : tt_bound::upper;
+  m_table.store(key, { bound, static_cast<std::int16_t>(alpha), best_move, depth });
+  return alpha;
+}
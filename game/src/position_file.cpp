@@ -0,0 +1,220 @@
+module;
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+export module position_file;
+import board;
+
+// Solved positions on disk: a header, then records sorted ascending, each one a native endian
+// uint64 holding board::symmetric_key() << 8 | the solver's score as a byte, so a position and
+// its mirror share a record. Readers map the file and binary search it, nothing is parsed up front.
+export struct position_file_header
+{
+  std::array<char, 4> magic;
+  std::uint32_t version;
+  std::uint8_t rows;
+  std::uint8_t columns;
+  std::uint8_t connect;
+  // positions have moves_played() in [min_moves, max_moves] and no winner; a book holds all of
+  // them, a tablebase only those its generator could reach from its seeds
+  std::uint8_t min_moves;
+  std::uint8_t max_moves;
+  std::array<std::uint8_t, 3> reserved;
+  std::uint64_t count;
+};
+
+static_assert(sizeof(position_file_header) == 24, "the header is read straight from the file");
+static_assert(board::column_height * board::columns <= 56, "keys must leave the low byte for the score");
+
+export constexpr std::array<char, 4> position_file_magic{ 'C', '4', 'P', 'F' };
+export constexpr std::uint32_t position_file_version = 1;
+
+export std::uint64_t make_position_record(const board &position, int score)
+{
+  return static_cast<std::uint64_t>(position.symmetric_key()) << 8 | static_cast<std::uint8_t>(score);
+}
+
+// sorts and deduplicates records in place, false when the file cannot be written
+export bool write_position_file(const std::string &path,
+  std::uint8_t min_moves,
+  std::uint8_t max_moves,
+  std::vector<std::uint64_t> &records);
+
+export class position_file
+{
+public:
+  // nullopt when the file is missing, truncated or made for another board
+  static std::optional<position_file> open(const std::string &path);
+  position_file(position_file &&other) noexcept;
+  position_file &operator=(position_file &&other) noexcept;
+  ~position_file();
+
+  const position_file_header &header() const { return *static_cast<const position_file_header *>(m_data); }
+  std::size_t size() const { return header().count; }
+  bool covers(const board &position) const
+  {
+    return position.moves_played() >= header().min_moves && position.moves_played() <= header().max_moves;
+  }
+  // the solver's exact score, nullopt when the position is not in the file
+  std::optional<int> score(const board &position) const;
+  // a move with the best score, needs every child of position either won at once or in the file
+  std::optional<std::uint8_t> best_move(const board &position) const;
+
+private:
+  position_file(void *data, std::size_t bytes) : m_data(data), m_bytes(bytes) {}
+  const std::uint64_t *records() const
+  {
+    return reinterpret_cast<const std::uint64_t *>(static_cast<const std::byte *>(m_data) + sizeof(position_file_header));
+  }
+
+  void *m_data;
+  std::size_t m_bytes;
+};
+
+module :private;
+
+bool write_position_file(const std::string &path,
+  std::uint8_t min_moves,
+  std::uint8_t max_moves,
+  std::vector<std::uint64_t> &records)
+{
+  std::sort(records.begin(), records.end());
+  // a position and its mirror can both have been solved, their records are the same
+  records.erase(std::unique(records.begin(), records.end()), records.end());
+  const position_file_header header{
+    position_file_magic, position_file_version, board::rows, board::columns, board::connect, min_moves, max_moves, {}, records.size()
+  };
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(std::uint64_t)));
+  return static_cast<bool>(out);
+}
+
+struct mapping
+{
+  void *data;
+  std::size_t bytes;
+};
+
+// the whole file, read only; lookups jump all over it, so the os is told not to read ahead.
+// data is nullptr when the file is missing or empty
+mapping map_file(const std::string &path)
+{
+#ifdef _WIN32
+  const auto file = ::CreateFileA(
+    path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+  if (file == INVALID_HANDLE_VALUE) { return { nullptr, 0 }; }
+  LARGE_INTEGER size{};
+  void *data = nullptr;
+  if (::GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+    if (const auto view = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+      data = ::MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+      // the view keeps the file alive on its own
+      ::CloseHandle(view);
+    }
+  }
+  ::CloseHandle(file);
+  return { data, data ? static_cast<std::size_t>(size.QuadPart) : 0 };
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) { return { nullptr, 0 }; }
+  struct stat info{};
+  const bool sized = ::fstat(fd, &info) == 0 && info.st_size > 0;
+  void *data = sized ? ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  // the mapping keeps the file alive on its own
+  ::close(fd);
+  if (data == MAP_FAILED) { return { nullptr, 0 }; }
+  ::madvise(data, static_cast<std::size_t>(info.st_size), MADV_RANDOM);
+  return { data, static_cast<std::size_t>(info.st_size) };
+#endif
+}
+
+void unmap_file(void *data, [[maybe_unused]] std::size_t bytes)
+{
+#ifdef _WIN32
+  ::UnmapViewOfFile(data);
+#else
+  ::munmap(data, bytes);
+#endif
+}
+
+std::optional<position_file> position_file::open(const std::string &path)
+{
+  const auto [data, bytes] = map_file(path);
+  if (!data) { return std::nullopt; }
+
+  // unmapped again by its destructor when the checks below fail
+  position_file file(data, bytes);
+  if (bytes < sizeof(position_file_header)) { return std::nullopt; }
+  const auto &h = file.header();
+  if (h.magic != position_file_magic || h.version != position_file_version || h.rows != board::rows
+      || h.columns != board::columns || h.connect != board::connect
+      || file.m_bytes != sizeof(position_file_header) + h.count * sizeof(std::uint64_t)) {
+    return std::nullopt;
+  }
+  return file;
+}
+
+position_file::position_file(position_file &&other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr)), m_bytes(std::exchange(other.m_bytes, 0))
+{}
+
+position_file &position_file::operator=(position_file &&other) noexcept
+{
+  std::swap(m_data, other.m_data);
+  std::swap(m_bytes, other.m_bytes);
+  return *this;
+}
+
+position_file::~position_file()
+{
+  if (m_data) { unmap_file(m_data, m_bytes); }
+}
+
+std::optional<int> position_file::score(const board &position) const
+{
+  if (!covers(position)) { return std::nullopt; }
+  const auto key = static_cast<std::uint64_t>(position.symmetric_key());
+  const auto *first = records();
+  const auto *last = first + size();
+  // the score byte is the low one, so every record of this key sorts at or after key << 8
+  const auto *found = std::lower_bound(first, last, key << 8);
+  if (found == last || *found >> 8 != key) { return std::nullopt; }
+  return static_cast<std::int8_t>(*found & 0xff);
+}
+
+std::optional<std::uint8_t> position_file::best_move(const board &position) const
+{
+  std::optional<std::uint8_t> best;
+  int best_score = 0;
+  for (const auto column : position.legal_moves()) {
+    auto child = position;
+    const auto row = child.play(column);
+    if (child.check_winner_at(*row, column)) { return column; }
+    const auto child_score =
+      child.moves_played() == board::cells ? std::optional<int>{ 0 } : score(child);
+    if (!child_score) { return std::nullopt; }
+    if (!best || -*child_score > best_score) {
+      best = column;
+      best_score = -*child_score;
+    }
+  }
+  return best;
+}
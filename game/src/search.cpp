@@ -0,0 +1,272 @@
+module;
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+export module search;
+import board;
+import evaluation;
+import rooster;
+import transposition_table;
+
+export struct search_limits
+{
+  // hard deadline for the whole search
+  std::int64_t time_ms = 1000;
+  std::uint8_t max_depth = board::cells;
+  // more than one adds lazy smp helper threads sharing the table
+  std::uint8_t threads = 1;
+  // set from another thread to stop early, the last finished iteration is the answer
+  const std::atomic<bool> *stop = nullptr;
+};
+
+export struct principal_variation
+{
+  std::array<std::uint8_t, board::cells> moves;
+  std::uint8_t size;
+  const std::uint8_t *begin() const { return moves.data(); }
+  const std::uint8_t *end() const { return moves.data() + size; }
+};
+
+// what one finished iteration found, also the final answer of a search
+export struct iteration_report
+{
+  std::uint8_t depth;
+  // from the side to move, see searcher::win_score
+  int score;
+  std::uint64_t nodes;
+  std::int64_t elapsed_ms;
+  double nodes_per_second;
+  principal_variation pv;
+  std::uint8_t best_move() const { return pv.moves[0]; }
+};
+
+// Iterative deepening alpha-beta: searches depth 1, 2, 3... until the deadline, each
+// iteration trying the previous principal variation first. Only finished iterations count,
+// so the answer is always a complete search even when the deadline cuts the last one short.
+// Its scores are not the solver's, do not share one table between the two.
+//
+// With more than one thread the search is lazy smp: helper threads search the same root at
+// staggered depths and only talk to the main thread through the table, which they keep full of
+// bounds and moves the main thread would have to find by itself. Only the main thread's result counts.
+export class searcher
+{
+public:
+  // a proven win scores win_score + cells - pieces on the board before the winning move,
+  // so faster wins score higher, losses are the negative and anything closer to 0 is a guess
+  constexpr static int win_score = 1000;
+  constexpr static int infinity = win_score + board::cells + 1;
+
+  using report_callback = std::function<void(const iteration_report &)>;
+
+  explicit searcher(transposition_table &table) noexcept;
+  // the position must have a legal move and no winner yet
+  iteration_report search(const board &position, const search_limits &limits, const report_callback &report = {});
+  static bool is_proven(int score) { return score >= win_score || score <= -win_score; }
+  // table probes of this searcher and the helpers of its last search, not while it is searching
+  tt_stats table_stats() const;
+
+private:
+  iteration_report iterate(const board &position,
+    const search_limits &limits,
+    const report_callback &report,
+    std::uint8_t first_depth);
+  // nodes of this searcher and its helpers
+  std::uint64_t total_nodes() const;
+  int negamax(board &position, int depth, int ply, int alpha, int beta, bool on_pv);
+  // static score of a position at the search horizon
+  int evaluate(const board &position) const;
+  bool out_of_time();
+
+  transposition_table &m_table;
+  std::uint64_t m_nodes = 0;
+  tt_stats m_table_stats{};
+  std::chrono::steady_clock::time_point m_start;
+  std::int64_t m_time_ms = 0;
+  bool m_stopped = false;
+  // set by the main thread when a helper should give up, or by the caller for the main thread
+  const std::atomic<bool> *m_abort = nullptr;
+  // m_nodes as seen from other threads, refreshed every few thousand nodes
+  std::atomic<std::uint64_t> m_published_nodes = 0;
+  std::vector<std::unique_ptr<searcher>> m_helpers;
+  // helpers taking part in the current search, the rest are kept for later searches
+  std::size_t m_active_helpers = 0;
+  principal_variation m_previous_pv{};
+  // triangular table, row ply holds the best line found from that ply on
+  std::array<principal_variation, board::cells + 1> m_pv{};
+};
+
+module :private;
+
+searcher::searcher(transposition_table &table) noexcept : m_table(table) {}
+
+iteration_report searcher::search(const board &position, const search_limits &limits, const report_callback &report)
+{
+  m_abort = limits.stop;
+  m_active_helpers = limits.threads > 1 ? limits.threads - 1 : 0;
+  if (m_active_helpers == 0) { return iterate(position, limits, report, 1); }
+
+  while (m_helpers.size() < m_active_helpers) { m_helpers.push_back(std::make_unique<searcher>(m_table)); }
+  std::atomic<bool> abort = false;
+  std::vector<std::jthread> threads;
+  for (std::size_t i = 0; i < m_active_helpers; ++i) {
+    auto &helper = *m_helpers[i];
+    helper.m_abort = &abort;
+    helper.m_published_nodes.store(0, std::memory_order_relaxed);
+    // half of the helpers run one ply ahead so the threads do not all walk the same tree in step
+    const auto first_depth = static_cast<std::uint8_t>(1 + (i + 1) % 2);
+    threads.emplace_back([&helper, &position, &limits, first_depth] { helper.iterate(position, limits, {}, first_depth); });
+  }
+  auto result = iterate(position, limits, report, 1);
+  abort.store(true, std::memory_order_relaxed);
+  threads.clear();
+  result.nodes = total_nodes();
+  return result;
+}
+
+iteration_report searcher::iterate(const board &position,
+  const search_limits &limits,
+  const report_callback &report,
+  std::uint8_t first_depth)
+{
+  m_start = now();
+  m_time_ms = limits.time_ms;
+  m_nodes = 0;
+  m_table_stats = {};
+  m_published_nodes.store(0, std::memory_order_relaxed);
+  m_stopped = false;
+  m_previous_pv.size = 0;
+
+  auto scratch = position;
+  const auto moves_left = board::cells - position.moves_played();
+  // depth 1 always finishes so there is a move to return, no matter how short the deadline
+  iteration_report best{ 0, 0, 0, 0, 0, { { board::centre_first[0] }, 0 } };
+  for (std::uint8_t depth = first_depth; depth <= limits.max_depth && depth <= moves_left; ++depth) {
+    const int score = negamax(scratch, depth, 0, -infinity, infinity, true);
+    if (m_stopped) { break; }
+    const auto ms = elapsed(m_start);
+    const auto nodes = total_nodes();
+    best = { depth, score, nodes, ms, static_cast<double>(nodes) * 1000.0 / static_cast<double>(ms > 0 ? ms : 1), m_pv[0] };
+    m_previous_pv = m_pv[0];
+    if (report) { report(best); }
+    if (is_proven(score)) { break; }
+  }
+  m_published_nodes.store(m_nodes, std::memory_order_relaxed);
+  return best;
+}
+
+std::uint64_t searcher::total_nodes() const
+{
+  auto nodes = m_nodes;
+  for (std::size_t i = 0; i < m_active_helpers; ++i) {
+    nodes += m_helpers[i]->m_published_nodes.load(std::memory_order_relaxed);
+  }
+  return nodes;
+}
+
+tt_stats searcher::table_stats() const
+{
+  auto stats = m_table_stats;
+  for (std::size_t i = 0; i < m_active_helpers; ++i) { stats += m_helpers[i]->m_table_stats; }
+  return stats;
+}
+
+bool searcher::out_of_time()
+{
+  // the clock is not free, only look at it every few thousand nodes
+  if ((m_nodes & 4095) == 0) {
+    m_published_nodes.store(m_nodes, std::memory_order_relaxed);
+    if (elapsed(m_start) >= m_time_ms || (m_abort && m_abort->load(std::memory_order_relaxed))) { m_stopped = true; }
+  }
+  return m_stopped;
+}
+
+int searcher::negamax(board &position, int depth, int ply, int alpha, int beta, bool on_pv)
+{
+  ++m_nodes;
+  m_pv[ply].size = 0;
+  // the first iteration runs to the end whatever the clock says
+  if (m_previous_pv.size > 0 && out_of_time()) { return 0; }
+  const int moves = position.moves_played();
+  if (moves == board::cells) { return 0; }
+
+  const auto legal = position.legal_moves();
+  for (const auto column : legal) {
+    const auto row = position.play(column);
+    const bool wins = position.check_winner_at(*row, column);
+    position.undo();
+    if (wins) {
+      m_pv[ply].moves[0] = column;
+      m_pv[ply].size = 1;
+      return win_score + board::cells - moves;
+    }
+  }
+  if (depth == 0) { return evaluate(position); }
+
+  // a position and its mirror share one entry, with the move stored as seen from the smaller hash;
+  // the table verifies 49 of its 64 bits, a rare false hit only costs this search a guess
+  const auto key = position.canonical_key();
+  const bool mirrored = key != position.hash();
+  const auto orient = [&](std::uint8_t column) {
+    return mirrored ? static_cast<std::uint8_t>(board::columns - 1 - column) : column;
+  };
+  auto table_move = board::centre_first[0];
+  if (const auto entry = m_table.probe(key, m_table_stats)) {
+    table_move = orient(entry->move);
+    // the pv is rebuilt from the tree, a cutoff on it would leave it empty
+    if (entry->depth >= depth && !on_pv) {
+      if (entry->bound == tt_bound::exact) { return entry->score; }
+      if (entry->bound == tt_bound::lower && entry->score >= beta) { return entry->score; }
+      if (entry->bound == tt_bound::upper && entry->score <= alpha) { return entry->score; }
+    }
+  }
+
+  // previous principal variation first, then the table's move, then centre first
+  const bool follow_pv = on_pv && ply < m_previous_pv.size;
+  std::array<std::uint8_t, board::columns> order{};
+  std::uint8_t count = 0;
+  if (follow_pv) { order[count++] = m_previous_pv.moves[ply]; }
+  if (!follow_pv || table_move != order[0]) { order[count++] = table_move; }
+  for (const auto column : board::centre_first) {
+    if (column != order[0] && (count < 2 || column != order[1])) { order[count++] = column; }
+  }
+
+  const int alpha_start = alpha;
+  auto best_move = table_move;
+  for (const auto column : order) {
+    if (!position.can_play(column)) { continue; }
+    position.play(column);
+    const bool child_on_pv = follow_pv && column == m_previous_pv.moves[ply];
+    const int score = -negamax(position, depth - 1, ply + 1, -beta, -alpha, child_on_pv);
+    position.undo();
+    if (m_stopped) { return 0; }
+    if (score > alpha) {
+      alpha = score;
+      best_move = column;
+      auto &line = m_pv[ply];
+      const auto &child = m_pv[ply + 1];
+      line.moves[0] = column;
+      for (std::uint8_t i = 0; i < child.size; ++i) { line.moves[i + 1] = child.moves[i]; }
+      line.size = child.size + 1;
+      if (alpha >= beta) {
+        m_table.store(
+          key, { tt_bound::lower, static_cast<std::int16_t>(alpha), orient(column), static_cast<std::uint8_t>(depth) });
+        return alpha;
+      }
+    }
+  }
+  const auto bound = alpha > alpha_start ? tt_bound::exact : tt_bound::upper;
+  m_table.store(key, { bound, static_cast<std::int16_t>(alpha), orient(best_move), static_cast<std::uint8_t>(depth) });
+  return alpha;
+}
+
+int searcher::evaluate(const board &position) const
+{
+  // a guess must never look like a proven result
+  return std::clamp(evaluate_threats(position), -win_score + 1, win_score - 1);
+}
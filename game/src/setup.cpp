@@ -1,8 +1,11 @@
 module;
 #include <string>
+#include <utility>
 export module setup;
 import rooster;
+import ai_player;
 import board;
+import position_file;
 
 export
 {
@@ -11,6 +14,7 @@ export
     cen::ipoint mouse_pos;
   };
 
+  // player 2 is the computer
   enum class turn_for { player1, player2 };
 
   struct game_state
@@ -26,6 +30,10 @@ export
       reg.add_component(id, game_state{ turn_for::player1, false });
       reg.add_component(id, input_state{ cen::ipoint{ 0, 0 } });
       reg.add_component(id, board{});
+      ai_player ai;
+      // the book is optional, it is made offline by book-gen
+      if (auto book = position_file::open(cen::base_path().copy() + "assets/book.bin")) { ai.use_book(std::move(*book)); }
+      reg.add_component(id, std::move(ai));
       reg.add_component(id, cen::event_handler{});
       const auto path = cen::base_path().copy() + "assets/BitPotion.ttf";
       reg.add_component(id, cen::font{ path, 100 });
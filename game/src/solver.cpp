@@ -0,0 +1,191 @@
+module;
+#include <array>
+#include <chrono>
+#include <cstdint>
+export module solver;
+import board;
+import position_file;
+import rooster;
+import transposition_table;
+
+// scores are seen from the side to move: a win with the k-th own piece scores cells / 2 + 1 - k,
+// a loss the negative of the opponent's win and a draw 0, so faster wins score higher
+export struct solver_result
+{
+  int score;
+  // false when the node budget ran out, score is meaningless then
+  bool complete;
+};
+
+// narrows a position's exact score with null window searches, each one only answering
+// "above or below med"; search(alpha, beta) runs one and returns its solver_result
+export template<typename Search> solver_result null_window_solve(const int moves_played, Search &&search)
+{
+  int min = -(board::cells - moves_played) / 2;
+  int max = (board::cells + 1 - moves_played) / 2;
+  while (min < max) {
+    int med = min + (max - min) / 2;
+    // bias towards 0, most positions are close to a draw and those searches are the cheap ones
+    if (med <= 0 && min / 2 < med) {
+      med = min / 2;
+    } else if (med >= 0 && max / 2 > med) {
+      med = max / 2;
+    }
+    const solver_result result = search(med, med + 1);
+    if (!result.complete) { return result; }
+    if (result.score <= med) {
+      max = result.score;
+    } else {
+      min = result.score;
+    }
+  }
+  return { min, true };
+}
+
+export class solver
+{
+public:
+  // a budget of 0 means unlimited, the table may be shared with other solvers
+  explicit solver(std::uint64_t node_budget = 0, transposition_table *table = nullptr) noexcept;
+  // exact score, the position must not be already won
+  solver_result solve(const board &position);
+  // alpha-beta search in the window [alpha, beta]
+  solver_result search(const board &position, int alpha, int beta);
+  // plies until the game ends with perfect play from a position with moves_played pieces
+  static int moves_to_end(int score, int moves_played);
+
+  // positions found in the tablebase are not searched, it must outlive the solver
+  void use_tablebase(const position_file *tablebase) { m_tablebase = tablebase; }
+
+  std::uint64_t nodes() const { return m_nodes; }
+  const tt_stats &table_stats() const { return m_table_stats; }
+  double nodes_per_second() const;
+  void reset_stats();
+
+private:
+  // plays and takes back moves on position, it is left as it was found
+  int negamax(board &position, int alpha, int beta);
+
+  std::uint64_t m_node_budget;
+  transposition_table *m_table;
+  const position_file *m_tablebase = nullptr;
+  std::uint64_t m_nodes = 0;
+  tt_stats m_table_stats{};
+  double m_seconds = 0;
+  bool m_aborted = false;
+};
+
+module :private;
+
+solver::solver(std::uint64_t node_budget, transposition_table *table) noexcept
+  : m_node_budget(node_budget), m_table(table)
+{}
+
+solver_result solver::solve(const board &position)
+{
+  return null_window_solve(position.moves_played(), [&](int alpha, int beta) { return search(position, alpha, beta); });
+}
+
+solver_result solver::search(const board &position, int alpha, int beta)
+{
+  const auto start = now();
+  m_aborted = false;
+  // the only copy, every node below plays and undoes moves on it
+  auto scratch = position;
+  const auto score = negamax(scratch, alpha, beta);
+  m_seconds += std::chrono::duration<double>(now() - start).count();
+  return { score, !m_aborted };
+}
+
+int solver::moves_to_end(int score, int moves_played)
+{
+  if (score == 0) { return board::cells - moves_played; }
+  // the winner's piece count when the game ends, against what it has now
+  const int winning_piece = board::cells / 2 + 1 - (score > 0 ? score : -score);
+  const int own_pieces = score > 0 ? moves_played / 2 : (moves_played + 1) / 2;
+  return 2 * (winning_piece - own_pieces) - (score > 0 ? 1 : 0);
+}
+
+double solver::nodes_per_second() const { return m_seconds > 0 ? static_cast<double>(m_nodes) / m_seconds : 0; }
+
+void solver::reset_stats()
+{
+  m_nodes = 0;
+  m_table_stats = {};
+  m_seconds = 0;
+}
+
+int solver::negamax(board &position, int alpha, int beta)
+{
+  ++m_nodes;
+  if (m_node_budget != 0 && m_nodes > m_node_budget) {
+    m_aborted = true;
+    return 0;
+  }
+  const int moves = position.moves_played();
+  if (moves == board::cells) { return 0; }
+
+  for (const auto column : position.legal_moves()) {
+    const auto row = position.play(column);
+    const bool wins = position.check_winner_at(*row, column);
+    position.undo();
+    if (wins) { return (board::cells + 1 - moves) / 2; }
+  }
+
+  // we cannot win right now, so the best we can hope for is winning with our next piece
+  const int max = (board::cells - 1 - moves) / 2;
+  if (beta > max) {
+    beta = max;
+    if (alpha >= beta) { return beta; }
+  }
+
+  // one lookup instead of the whole subtree
+  if (m_tablebase) {
+    if (const auto score = m_tablebase->score(position)) { return *score; }
+  }
+
+  std::uint8_t table_move = board::centre_first[0];
+  const auto key = position.key();
+  const auto depth = static_cast<std::uint8_t>(board::cells - moves);
+  if (m_table) {
+    if (const auto entry = m_table->probe(key, m_table_stats)) {
+      table_move = entry->move;
+      // shallower entries come from a depth limited search, only their move is worth anything here
+      if (entry->depth >= depth) {
+        if (entry->bound == tt_bound::exact) { return entry->score; }
+        if (entry->bound == tt_bound::upper && beta > entry->score) {
+          beta = entry->score;
+        } else if (entry->bound == tt_bound::lower && alpha < entry->score) {
+          alpha = entry->score;
+        }
+        if (alpha >= beta) { return alpha; }
+      }
+    }
+  }
+
+  const int alpha_start = alpha;
+  auto best_move = table_move;
+  // the table's move first, then the rest centre first
+  for (int i = -1; i < board::columns; ++i) {
+    const auto column = i < 0 ? table_move : board::centre_first[i];
+    if (i >= 0 && column == table_move) { continue; }
+    if (!position.can_play(column)) { continue; }
+    position.play(column);
+    const int score = -negamax(position, -beta, -alpha);
+    position.undo();
+    if (m_aborted) { return 0; }
+    if (score >= beta) {
+      if (m_table) { m_table->store(key, { tt_bound::lower, static_cast<std::int16_t>(score), column, depth }); }
+      return score;
+    }
+    if (score > alpha) {
+      alpha = score;
+      best_move = column;
+    }
+  }
+  if (m_table) {
+    const auto bound = alpha > alpha_start ? tt_bound::exact : tt_bound::upper;
+    m_table->store(key, { bound, static_cast<std::int16_t>(alpha), best_move, depth });
+  }
+  return alpha;
+}
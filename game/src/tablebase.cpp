@@ -0,0 +1,80 @@
+module;
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+export module tablebase;
+import board;
+import position_file;
+
+// Every position with up to 42 empty cells is far too many to store, so a table is built for
+// the endgames that matter: all positions reachable from a set of seeds. The reachable positions
+// are listed layer by layer down to the full board, then solved backwards from it: each layer's
+// scores come straight from the finished layer below, no search at all.
+
+// called once per layer as it is listed, with its size and how many empty cells its positions have
+export using tablebase_progress = std::function<void(std::size_t positions, std::uint8_t empty_cells)>;
+
+// records for write_position_file, scored like solver::solve. Every seed needs at least
+// board::cells - empty_cells pieces and no winner; the file covers moves in [cells - empty_cells, cells]
+export std::vector<std::uint64_t> solve_endgames(const std::vector<board> &seeds,
+  std::uint8_t empty_cells,
+  const tablebase_progress &progress = {});
+
+module :private;
+
+std::vector<std::uint64_t> solve_endgames(const std::vector<board> &seeds,
+  std::uint8_t empty_cells,
+  const tablebase_progress &progress)
+{
+  const auto first_moves = board::cells - empty_cells;
+  // layers[i] holds the positions with first_moves + i pieces, one of each mirrored pair
+  std::vector<std::vector<board>> layers(empty_cells + 1);
+  std::vector<std::unordered_set<std::uint64_t>> seen(empty_cells + 1);
+  const auto add = [&](const board &position) {
+    const auto layer = static_cast<std::size_t>(position.moves_played() - first_moves);
+    if (seen[layer].insert(static_cast<std::uint64_t>(position.symmetric_key())).second) {
+      layers[layer].push_back(position);
+    }
+  };
+  for (const auto &seed : seeds) { add(seed); }
+  for (std::size_t layer = 0; layer < empty_cells; ++layer) {
+    for (const auto &position : layers[layer]) {
+      for (const auto column : position.legal_moves()) {
+        auto child = position;
+        const auto row = child.play(column);
+        // a won position needs no entry, its parent sees the win itself
+        if (!child.check_winner_at(*row, column)) { add(child); }
+      }
+    }
+    seen[layer].clear();
+    if (progress) { progress(layers[layer].size(), static_cast<std::uint8_t>(empty_cells - layer)); }
+  }
+
+  std::vector<std::uint64_t> records;
+  std::unordered_map<std::uint64_t, int> below;
+  for (std::size_t layer = empty_cells + 1; layer-- > 0;) {
+    std::unordered_map<std::uint64_t, int> scores;
+    for (const auto &position : layers[layer]) {
+      const int moves = position.moves_played();
+      int score = moves == board::cells ? 0 : -board::cells;
+      for (const auto column : position.legal_moves()) {
+        auto child = position;
+        const auto row = child.play(column);
+        if (child.check_winner_at(*row, column)) {
+          score = (board::cells + 1 - moves) / 2;
+          break;
+        }
+        score = std::max(score, -below.at(static_cast<std::uint64_t>(child.symmetric_key())));
+      }
+      scores.emplace(static_cast<std::uint64_t>(position.symmetric_key()), score);
+      records.push_back(make_position_record(position, score));
+    }
+    below = std::move(scores);
+    layers[layer].clear();
+  }
+  return records;
+}
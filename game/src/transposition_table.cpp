@@ -0,0 +1,121 @@
+module;
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+export module transposition_table;
+
+export enum class tt_bound : std::uint8_t { none, lower, upper, exact };
+
+export struct tt_entry
+{
+  tt_bound bound;
+  std::int16_t score;
+  // up to 63 columns
+  std::uint8_t move;
+  // plies searched below the position, a full solve stores the plies left in the game
+  std::uint8_t depth;
+};
+
+export struct tt_stats
+{
+  std::uint64_t hits;
+  std::uint64_t misses;
+  // the slot held another position
+  std::uint64_t collisions;
+
+  tt_stats &operator+=(const tt_stats &other)
+  {
+    hits += other.hits;
+    misses += other.misses;
+    collisions += other.collisions;
+    return *this;
+  }
+};
+
+// Fixed size table of packed 64 bit entries, shared between search threads without locks.
+// Every entry is written and read with a single relaxed atomic, so a probe sees either
+// the old or the new entry, never half of each. The low bits of the key pick the slot and
+// the next 32 are stored in it, so with at least 1 MB (2^17 slots) a 49 bit key is verified exactly.
+// A probe never writes to the table, its statistics go to the caller's tt_stats, one per thread.
+export class transposition_table
+{
+public:
+  constexpr static std::size_t min_size_mb = 1;
+
+  explicit transposition_table(std::size_t size_mb = 16);
+  // drops every entry, the size is rounded down to a power of two
+  void resize(std::size_t size_mb);
+  void clear();
+  void store(std::uint64_t key, const tt_entry &entry);
+  std::optional<tt_entry> probe(std::uint64_t key, tt_stats &stats) const;
+
+  std::size_t size() const { return m_size; }
+  std::size_t size_mb() const { return m_size * sizeof(std::uint64_t) >> 20; }
+
+private:
+  std::uint64_t slot(std::uint64_t key) const { return key & (m_size - 1); }
+  std::uint64_t fragment(std::uint64_t key) const { return (key >> m_index_bits) & 0xffff'ffff; }
+
+  std::unique_ptr<std::atomic<std::uint64_t>[]> m_entries;
+  std::size_t m_size = 0;
+  int m_index_bits = 0;
+};
+
+module :private;
+
+// layout: fragment:32 | depth:8 | score:16 | move:6 | bound:2, all zero is an empty slot
+constexpr std::uint64_t pack(const std::uint64_t fragment, const tt_entry &entry)
+{
+  return fragment << 32 | std::uint64_t{ entry.depth } << 24
+         | std::uint64_t{ static_cast<std::uint16_t>(entry.score) } << 8 | std::uint64_t{ entry.move & 0x3fu } << 2
+         | static_cast<std::uint64_t>(entry.bound);
+}
+
+constexpr tt_entry unpack(const std::uint64_t packed)
+{
+  return { static_cast<tt_bound>(packed & 0x3),
+    static_cast<std::int16_t>(static_cast<std::uint16_t>(packed >> 8)),
+    static_cast<std::uint8_t>((packed >> 2) & 0x3f),
+    static_cast<std::uint8_t>(packed >> 24) };
+}
+
+transposition_table::transposition_table(std::size_t size_mb) { resize(size_mb); }
+
+void transposition_table::resize(std::size_t size_mb)
+{
+  if (size_mb < min_size_mb) { size_mb = min_size_mb; }
+  m_size = std::bit_floor((size_mb << 20) / sizeof(std::uint64_t));
+  m_index_bits = std::countr_zero(m_size);
+  m_entries = std::make_unique<std::atomic<std::uint64_t>[]>(m_size);
+}
+
+void transposition_table::clear()
+{
+  for (std::size_t i = 0; i < m_size; ++i) { m_entries[i].store(0, std::memory_order_relaxed); }
+}
+
+void transposition_table::store(std::uint64_t key, const tt_entry &entry)
+{
+  assert(entry.bound != tt_bound::none);
+  // always replace, the newest entry is the most likely to be probed again
+  m_entries[slot(key)].store(pack(fragment(key), entry), std::memory_order_relaxed);
+}
+
+std::optional<tt_entry> transposition_table::probe(std::uint64_t key, tt_stats &stats) const
+{
+  const auto packed = m_entries[slot(key)].load(std::memory_order_relaxed);
+  if (packed == 0) {
+    ++stats.misses;
+    return std::nullopt;
+  }
+  if ((packed >> 32) != fragment(key)) {
+    ++stats.collisions;
+    return std::nullopt;
+  }
+  ++stats.hits;
+  return unpack(packed);
+}
@@ -1,8 +1,15 @@
 module;
 #include <algorithm>
+#include <atomic>
 #include <bitset>
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <cstddef>
@@ -40,6 +47,23 @@ type_guid get_type_guid() {
     return my_guid;
 }
 
+// Query Id
+
+// Counted apart from the type guids, which index every entity's component bitset.
+
+using query_id = std::size_t;
+
+inline query_id get_next_query_id() noexcept {
+    static query_id x = 0;
+    return x++;
+}
+
+template <typename Query>
+query_id get_query_id() {
+    static const query_id my_id = get_next_query_id();
+    return my_id;
+}
+
 // Dynamic Bitset
 
 class dynamic_bitset {
@@ -523,13 +547,239 @@ struct database_traits {
     struct visitor_traits<R (Visitor::*)(Ts...) &&> : visitor_traits_impl<std::decay_t<Ts>...> {};
 };
 
+// Visitor Parameters
+
+template <typename... Ts>
+struct type_list {};
+
+template <typename... Ts>
+struct visitor_params_impl {
+    using type = type_list<Ts...>;
+    using decayed = type_list<std::decay_t<Ts>...>;
+};
+
+template <typename Visitor>
+struct visitor_params : visitor_params<decltype(&std::decay_t<Visitor>::operator())> {};
+
+template <typename R, typename... Ts>
+struct visitor_params<R (&)(Ts...)> : visitor_params_impl<Ts...> {};
+
+template <typename Visitor, typename R, typename... Ts>
+struct visitor_params<R (Visitor::*)(Ts...)> : visitor_params_impl<Ts...> {};
+
+template <typename Visitor, typename R, typename... Ts>
+struct visitor_params<R (Visitor::*)(Ts...) const> : visitor_params_impl<Ts...> {};
+
+template <typename Visitor, typename R, typename... Ts>
+struct visitor_params<R (Visitor::*)(Ts...)&> : visitor_params_impl<Ts...> {};
+
+template <typename Visitor, typename R, typename... Ts>
+struct visitor_params<R (Visitor::*)(Ts...) const &> : visitor_params_impl<Ts...> {};
+
+template <typename Visitor, typename R, typename... Ts>
+struct visitor_params<R (Visitor::*)(Ts...) &&> : visitor_params_impl<Ts...> {};
+
+// Thread Pool
+
+/*! Thread Pool
+ *
+ * Runs the indices of a job on a fixed set of worker threads, with the calling thread helping.
+ *
+ * Jobs may be started from several threads at once, and from inside other jobs. The caller works
+ * through its own job's indices before it waits, so a job always finishes even when every worker
+ * is busy with something else.
+ */
+class thread_pool {
+public:
+    using size_type = std::size_t;
+
+    /*! Creates the pool.
+     *
+     * @param threads Number of worker threads, not counting the threads that start jobs.
+     */
+    explicit thread_pool(size_type threads) {
+        for (size_type i = 0; i < threads; ++i) {
+            workers.emplace_back([this] { work_loop(); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /*! Get the number of worker threads.
+     */
+    size_type size() const {
+        return workers.size();
+    }
+
+    /*! Runs task(i) for every i in [0, count), returns once all of them have returned.
+     *
+     * The task is called from several threads at once, in no particular order.
+     *
+     * @param count Number of indices.
+     * @param task Task function.
+     */
+    template <typename Task>
+    void run(size_type count, Task&& task) {
+        if (workers.empty() || count <= 1) {
+            for (size_type i = 0; i < count; ++i) {
+                task(i);
+            }
+            return;
+        }
+
+        auto call = [](void* t, size_type i) { (*static_cast<std::remove_reference_t<Task>*>(t))(i); };
+        job j{call, &task, count};
+
+        {
+            std::lock_guard lock(mutex);
+            jobs.push_back(&j);
+        }
+        wake.notify_all();
+
+        auto ran = work(j);
+
+        std::unique_lock lock(mutex);
+        if (auto it = std::find(jobs.begin(), jobs.end(), &j); it != jobs.end()) {
+            jobs.erase(it);
+        }
+        j.done += ran;
+        finished.wait(lock, [&] { return j.done == j.count && j.users == 0; });
+    }
+
+private:
+    struct job {
+        void (*call)(void* task, size_type i);
+        void* task;
+        size_type count;
+        std::atomic<size_type> next = 0;
+        // both guarded by the mutex
+        size_type done = 0;
+        size_type users = 0;
+    };
+
+    // claims indices until none are left, returns how many it ran
+    static size_type work(job& j) {
+        size_type ran = 0;
+        for (auto i = j.next.fetch_add(1, std::memory_order_relaxed); i < j.count; i = j.next.fetch_add(1, std::memory_order_relaxed)) {
+            j.call(j.task, i);
+            ++ran;
+        }
+        return ran;
+    }
+
+    void work_loop() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+
+            if (stopping) {
+                return;
+            }
+
+            auto& j = *jobs.front();
+
+            if (j.next.load(std::memory_order_relaxed) >= j.count) {
+                jobs.erase(jobs.begin());
+                continue;
+            }
+
+            // the caller waits for users to drop to zero, so the job outlives this access
+            ++j.users;
+            lock.unlock();
+            auto ran = work(j);
+            lock.lock();
+            j.done += ran;
+            --j.users;
+
+            if (j.done == j.count && j.users == 0) {
+                finished.notify_all();
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::vector<job*> jobs;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};
+
+/*! The pool used when none is given, one worker less than there are cores.
+ */
+inline thread_pool& default_thread_pool() {
+    static thread_pool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+// Parallel Visitor Check
+
+// true when visiting in parallel cannot write through the parameter, or the write was declared
+template <typename DB, typename Param, typename... Writes>
+constexpr bool is_declared_param() {
+    using traits = component_traits<DB, std::decay_t<Param>>;
+    using category = typename traits::category;
+    using component = typename traits::component;
+
+    if constexpr ((std::is_same_v<component, Writes> || ...)) {
+        return true;
+    } else if constexpr (std::is_same_v<category, component_tags::normal>) {
+        return !std::is_lvalue_reference_v<Param> || std::is_const_v<std::remove_reference_t<Param>>;
+    } else if constexpr (std::is_same_v<category, component_tags::optional>) {
+        return std::is_same_v<typename component_traits<DB, component>::category, component_tags::tagged>;
+    } else {
+        return true;
+    }
+}
+
+template <typename DB, typename... Writes, typename... Params>
+constexpr bool is_declared_visitor(type_list<Params...>) {
+    return (is_declared_param<DB, Params, Writes...>() && ...);
+}
+
 // Component Set
 
+/*! Component set report
+ *
+ * How densely the components of one type are packed.
+ */
+struct component_set_report {
+    using size_type = std::size_t;
+
+    type_guid guid = 0;
+    // live components
+    size_type count = 0;
+    // slots a visit goes through, live or not
+    size_type slots = 0;
+    // slots allocated in buckets
+    size_type reserved = 0;
+
+    /*! Share of the visited slots that are holes, from 0 when packed to almost 1.
+     */
+    double fragmentation() const {
+        return slots == 0 ? 0.0 : 1.0 - static_cast<double>(count) / static_cast<double>(slots);
+    }
+};
+
 class component_set {
 public:
     using size_type = std::size_t;
     virtual ~component_set() = 0;
     virtual void remove(size_type entid) = 0;
+    virtual void compact() = 0;
+    virtual component_set_report get_report() const = 0;
 
     size_type get_count() const {
         return count;
@@ -629,6 +879,54 @@ public:
         return back_index;
     }
 
+    /*! Moves live components into the holes removed ones left, so they fill the first get_count() slots.
+     *
+     * Holes are filled from the back, and buckets that end up empty are freed.
+     *
+     * @warning
+     * Invalidates the ComIDs of moved components.
+     */
+    virtual void compact() override final {
+        auto live = get_count();
+        size_type hole = 0;
+        size_type top = back_index;
+
+        while (true) {
+            while (hole < live && is_valid(hole)) {
+                ++hole;
+            }
+            if (hole == live) {
+                break;
+            }
+            // there are as many live components at or past live as holes below it
+            do {
+                --top;
+            } while (!is_valid(top));
+
+            auto& from = buckets[get_bucket_index(top)][get_relative_index(top)];
+            auto& to = buckets[get_bucket_index(hole)][get_relative_index(hole)];
+            new (&to.component) T(std::move(from.component));
+            from.component.~T();
+
+            auto entid = comid_to_entid[top];
+            entid_to_comid[entid] = hole;
+            comid_to_entid[hole] = entid;
+            comid_to_entid[top] = null_id;
+            ++hole;
+        }
+
+        back_index = live;
+        free_head = live;
+
+        auto num_buckets = (live + bucket_size - 1) / bucket_size;
+        buckets.resize(num_buckets);
+        comid_to_entid.resize(get_total_size(num_buckets));
+    }
+
+    virtual component_set_report get_report() const override final {
+        return {0, get_count(), back_index, get_total_size(buckets.size())};
+    }
+
 private:
     union storage {
         size_type next_free;
@@ -665,8 +963,85 @@ class component_set_impl<tag<T>> final : public component_set {
 public:
     virtual ~component_set_impl() = default;
     virtual void remove([[maybe_unused]] size_type entid) override final {}
+    virtual void compact() override final {}
+    virtual component_set_report get_report() const override final {
+        return {};
+    }
+};
+
+// Query Base
+
+/*! Query base
+ *
+ * The entities that match a query, kept in a dense list that the database updates whenever
+ * an entity gains or loses one of the components the query looks at.
+ */
+class query_base {
+public:
+    using size_type = std::size_t;
+
+    static constexpr size_type null_id = static_cast<size_type>(-1);
+
+    query_base(std::vector<type_guid> req, std::vector<type_guid> den)
+        : required(std::move(req)), denied(std::move(den)) {
+        watched = required;
+        watched.insert(watched.end(), denied.begin(), denied.end());
+    }
+
+    query_base(const query_base&) = delete;
+    query_base& operator=(const query_base&) = delete;
+
+    virtual ~query_base() = default;
+
+    /*! Adds the entity to the list or removes it, depending on whether it matches now.
+     */
+    void update(size_type entid, const dynamic_bitset& components) {
+        auto match = std::all_of(required.begin(), required.end(), [&](type_guid guid) { return components.get(guid); }) &&
+                     std::none_of(denied.begin(), denied.end(), [&](type_guid guid) { return components.get(guid); });
+        auto pos = entid < positions.size() ? positions[entid] : null_id;
+
+        if (match && pos == null_id) {
+            if (entid >= positions.size()) {
+                positions.resize((entid + 1) * 3 / 2, null_id);
+            }
+            positions[entid] = matches.size();
+            matches.push_back(entid);
+        } else if (!match && pos != null_id) {
+            auto last = matches.back();
+            matches[pos] = last;
+            positions[last] = pos;
+            matches.pop_back();
+            positions[entid] = null_id;
+        }
+    }
+
+    /*! Component types whose addition or removal can change the result.
+     */
+    const std::vector<type_guid>& get_watched() const {
+        return watched;
+    }
+
+    /*! Indices of the matching entities, in no particular order.
+     */
+    const std::vector<size_type>& get_entids() const {
+        return matches;
+    }
+
+    size_type size() const {
+        return matches.size();
+    }
+
+private:
+    std::vector<type_guid> required;
+    std::vector<type_guid> denied;
+    std::vector<type_guid> watched;
+    std::vector<size_type> matches;
+    std::vector<size_type> positions;
 };
 
+template <typename... Components>
+class query;
+
 // Opaque index
 
 template <typename Tag, typename Friend, typename Index>
@@ -759,6 +1134,7 @@ public:
         }
 
         entities[index].components.set(0);
+        notify_queries(index, 0);
 
         return {index, entities[index].version};
     }
@@ -785,6 +1161,7 @@ public:
         }
 
         entities[index].components.zero();
+        notify_queries(index, 0);
         ++entities[index].version;
         free_entities.push_back(index);
     }
@@ -824,6 +1201,7 @@ public:
         } else {
             cid = com_set.assign(index, std::forward<T>(com));
             ent_coms.set(guid);
+            notify_queries(index, guid);
         }
 
         return cid;
@@ -844,7 +1222,10 @@ public:
 
         get_or_create_com_set<tag<T>>();
 
-        ent_coms.set(guid);
+        if (!ent_coms.get(guid)) {
+            ent_coms.set(guid);
+            notify_queries(index, guid);
+        }
     }
 
     template <typename T>
@@ -884,6 +1265,7 @@ public:
         auto& com_set = *get_com_set<Com>();
         com_set.remove(index);
         entities[index].components.unset(guid);
+        notify_queries(index, guid);
     }
 
     /*! Get a component.
@@ -1005,6 +1387,102 @@ public:
         return visit_helper(std::forward<Visitor>(visitor), primary_component{});
     }
 
+    /*! Visit the Database in parallel.
+     *
+     * Like visit, but splits the slots of the primary component into chunks of `grain` slots
+     * and visits the chunks on a thread pool. Each entity is visited by exactly one thread.
+     *
+     * The visitor may only take components by value or by const reference, unless it names
+     * the components it writes as template arguments: `db.visit_parallel<position>(visitor)`
+     * allows `position&` and `optional<position>` parameters. Writes must stay within the
+     * visited entity.
+     *
+     * @warning The Database must not be changed while visiting, and the visitor is called
+     *          from several threads at once, so anything else it touches must be synchronized.
+     *
+     * @tparam Writes Component types the visitor writes.
+     * @tparam Visitor Visitor function type.
+     * @param visitor Visitor function.
+     * @param grain Number of component slots per task, 0 is taken as 1.
+     * @param pool Thread pool to visit on.
+     */
+    template <typename... Writes, typename Visitor>
+    void visit_parallel(Visitor&& visitor, component_set::size_type grain = 4096, thread_pool& pool = default_thread_pool()) {
+        using db_traits = database_traits<database>;
+        using traits = typename db_traits::visitor_traits<Visitor>;
+        using primary_component = typename traits::primary_component;
+        using params = typename visitor_params<Visitor>::type;
+
+        static_assert(is_declared_visitor<database, Writes...>(params{}),
+            "Parallel visitors must take components by value or const reference, or name the components they write.");
+
+        visit_parallel_helper(visitor, primary_component{}, std::max(grain, component_set::size_type{1}), pool);
+    }
+
+    /*! Get a cached query.
+     *
+     * Returns the query for the given parameter types, creating it on first use. The query keeps
+     * a dense list of the entities that match the parameters, updated whenever components are added
+     * or removed and entities are created or destroyed, so visiting it touches only matching entities.
+     *
+     * Parameters follow the same rules as visitor parameters, e.g. `get_query<ent_id, position, deny<frozen>>()`.
+     * The query lives as long as the Database.
+     *
+     * @warning Creating a query changes the Database. Create queries before anything visits the
+     *          Database from several threads, and keep the references.
+     *
+     * @tparam Components Parameter types to match.
+     * @return Reference to the query.
+     */
+    template <typename... Components>
+    query<Components...>& get_query() {
+        auto id = get_query_id<query<Components...>>();
+
+        if (id >= queries.size()) {
+            queries.resize(id + 1);
+        }
+
+        auto& q = queries[id];
+
+        if (!q) {
+            q = std::make_unique<query<Components...>>();
+
+            for (auto watched : q->get_watched()) {
+                if (watched >= query_watchers.size()) {
+                    query_watchers.resize(watched + 1);
+                }
+                query_watchers[watched].push_back(q.get());
+            }
+
+            for (ent_id::index_type i = 0; i < entities.size(); ++i) {
+                if (entities[i].components.get(0)) {
+                    q->update(i, entities[i].components);
+                }
+            }
+        }
+
+        return static_cast<query<Components...>&>(*q);
+    }
+
+    /*! Visit the entities of a query.
+     *
+     * Like visit, but only goes through the entities the query matched. Entities must also match
+     * the visitor's parameters, which are usually the same as the query's.
+     *
+     * @warning Changes to the entities the query matches while visiting could result in weird behavior.
+     *
+     * @param q Query from get_query.
+     * @param visitor Visitor function.
+     */
+    template <typename... Components, typename Visitor>
+    void visit(const query<Components...>& q, Visitor&& visitor) {
+        using db_traits = database_traits<database>;
+        using traits = typename db_traits::visitor_traits<Visitor>;
+        using primary_component = typename traits::primary_component;
+
+        visit_query_helper(q, visitor, primary_component{});
+    }
+
     /*! Get the number of entities in the Database.
      *
      * @return Number of entities in the Database.
@@ -1026,6 +1504,71 @@ public:
         }
     }
 
+    /*! Compact the storage of a component type.
+     *
+     * Moves live components of type Com into the holes left by removed ones, so visits
+     * no longer skip over them, and frees the memory that is left over.
+     *
+     * @warning
+     * ComIDs of the moved components are invalidated.
+     *
+     * @tparam Com Type of the components to compact.
+     */
+    template <typename Com>
+    void compact() {
+        if (auto set = get_com_set<Com>()) {
+            set->compact();
+        }
+    }
+
+    /*! Compact the storage of every component type.
+     *
+     * @see compact<Com>()
+     */
+    void compact() {
+        for (auto& set : component_sets) {
+            if (set) {
+                set->compact();
+            }
+        }
+    }
+
+    /*! Report how fragmented the storage of a component type is.
+     *
+     * @tparam Com Type of the components to report on.
+     * @return Report for Com, all zero if no component of the type was ever added.
+     */
+    template <typename Com>
+    component_set_report get_fragmentation() const {
+        if (auto set = get_com_set<Com>()) {
+            auto report = set->get_report();
+            report.guid = get_type_guid<Com>();
+            return report;
+        } else {
+            return {};
+        }
+    }
+
+    /*! Report how fragmented the storage of every component type is.
+     *
+     * Tags have no storage and are left out.
+     *
+     * @return One report per component type, identified by its guid.
+     */
+    std::vector<component_set_report> get_fragmentation() const {
+        std::vector<component_set_report> reports;
+        for (type_guid guid = 0; guid < component_sets.size(); ++guid) {
+            if (component_sets[guid]) {
+                auto report = component_sets[guid]->get_report();
+                if (report.reserved > 0) {
+                    report.guid = guid;
+                    reports.push_back(report);
+                }
+            }
+        }
+        return reports;
+    }
+
     /*! Converts an ent_id to a void* for storage purposes.
      *
      * @warning This is not a valid pointer and relies on widespread compiler-specific behavior.
@@ -1162,17 +1705,849 @@ private:
         }
     }
 
-    std::vector<entity> entities;
-    std::vector<ent_id::index_type> free_entities;
-    std::vector<std::unique_ptr<component_set>> component_sets;
+    template <typename Visitor, typename Component>
+    void visit_parallel_helper(Visitor& visitor, primary<Component>, component_set::size_type grain, thread_pool& pool) {
+        using db_traits = database_traits<database>;
+        using visitor_traits = typename db_traits::visitor_traits<Visitor>;
+
+        auto traits = visitor_traits{};
+
+        if (auto com_set_ptr = get_com_set<Component>(traits.template get_guid<Component>())) {
+            auto& com_set = *com_set_ptr;
+            auto sz = com_set.capacity();
+
+            pool.run((sz + grain - 1) / grain, [&](component_set::size_type chunk) {
+                for (com_id cid = chunk * grain, end = std::min(sz, (chunk + 1) * grain); cid < end; ++cid) {
+                    if (com_set.is_valid(cid)) {
+                        auto i = com_set.get_entid(cid);
+                        traits.apply(*this, {i, entities[i].version}, cid, visitor);
+                    }
+                }
+            });
+        }
+    }
+
+    template <typename Visitor>
+    void visit_parallel_helper(Visitor& visitor, primary<void>, component_set::size_type grain, thread_pool& pool) {
+        using db_traits = database_traits<database>;
+        using visitor_traits = typename db_traits::visitor_traits<Visitor>;
+
+        auto traits = visitor_traits{};
+        auto sz = entities.size();
+
+        pool.run((sz + grain - 1) / grain, [&](component_set::size_type chunk) {
+            for (auto i = chunk * grain, end = std::min(sz, (chunk + 1) * grain); i < end; ++i) {
+                if (entities[i].components.get(0)) {
+                    traits.apply(*this, {i, entities[i].version}, {}, visitor);
+                }
+            }
+        });
+    }
+
+    void notify_queries(ent_id::index_type index, type_guid guid) {
+        if (guid < query_watchers.size()) {
+            for (auto q : query_watchers[guid]) {
+                q->update(index, entities[index].components);
+            }
+        }
+    }
+
+    template <typename Visitor, typename Component>
+    void visit_query_helper(const query_base& q, Visitor& visitor, primary<Component>) {
+        using db_traits = database_traits<database>;
+        using visitor_traits = typename db_traits::visitor_traits<Visitor>;
+
+        auto traits = visitor_traits{};
+        auto guid = traits.template get_guid<Component>();
+
+        if (auto com_set_ptr = get_com_set<Component>(guid)) {
+            auto& com_set = *com_set_ptr;
+            auto& entids = q.get_entids();
+
+            for (std::size_t k = 0; k < entids.size(); ++k) {
+                auto i = entids[k];
+                if (entities[i].components.get(guid)) {
+                    traits.apply(*this, {i, entities[i].version}, com_set.get_comid(i), visitor);
+                }
+            }
+        }
+    }
+
+    template <typename Visitor>
+    void visit_query_helper(const query_base& q, Visitor& visitor, primary<void>) {
+        using db_traits = database_traits<database>;
+        using visitor_traits = typename db_traits::visitor_traits<Visitor>;
+
+        auto traits = visitor_traits{};
+        auto& entids = q.get_entids();
+
+        for (std::size_t k = 0; k < entids.size(); ++k) {
+            auto i = entids[k];
+            traits.apply(*this, {i, entities[i].version}, {}, visitor);
+        }
+    }
+
+    std::vector<entity> entities;
+    std::vector<ent_id::index_type> free_entities;
+    std::vector<std::unique_ptr<component_set>> component_sets;
+    std::vector<std::unique_ptr<query_base>> queries;
+    std::vector<std::vector<query_base*>> query_watchers;
+};
+
+// Query
+
+/*! Query
+ *
+ * A cached query, see database::get_query.
+ */
+template <typename... Components>
+class query final : public query_base {
+public:
+    query()
+        : query_base(get_required(), get_denied()) {}
+
+private:
+    template <typename Com>
+    using tag_t = typename component_traits<database, Com>::category;
+
+    template <typename Com>
+    using com_t = typename component_traits<database, Com>::component;
+
+    template <typename Com>
+    static void add_guid(std::vector<type_guid>& guids, bool denied) {
+        if constexpr (std::is_same_v<tag_t<Com>, component_tags::inverted>) {
+            if (denied) {
+                guids.push_back(get_type_guid<com_t<Com>>());
+            }
+        } else if constexpr (std::is_base_of_v<component_tags::positive, tag_t<Com>>) {
+            if (!denied) {
+                guids.push_back(get_type_guid<com_t<Com>>());
+            }
+        }
+    }
+
+    // every query requires guid 0, which is set while the entity exists
+    static std::vector<type_guid> get_required() {
+        std::vector<type_guid> guids = {0};
+        (add_guid<Components>(guids, false), ...);
+        return guids;
+    }
+
+    static std::vector<type_guid> get_denied() {
+        std::vector<type_guid> guids;
+        (add_guid<Components>(guids, true), ...);
+        return guids;
+    }
+};
+
+// Column Type
+
+/*! Column type
+ *
+ * Lets an archetype move and destroy components it only knows by their size and alignment.
+ */
+struct column_type {
+    type_guid guid;
+    std::size_t size;
+    std::size_t align;
+    void (*relocate)(void* to, void* from);
+    void (*destroy)(void* at);
+};
+
+template <typename T>
+const column_type* get_column_type() {
+    static const column_type type = {
+        get_type_guid<T>(),
+        sizeof(T),
+        alignof(T),
+        [](void* to, void* from) {
+            auto& com = *static_cast<T*>(from);
+            new (to) T(std::move(com));
+            com.~T();
+        },
+        [](void* at) { static_cast<T*>(at)->~T(); },
+    };
+    return &type;
+}
+
+// Archetype
+
+/*! Archetype
+ *
+ * Stores every entity that has exactly the same set of components.
+ *
+ * Rows live in fixed size chunks. Each chunk holds the entity indices, followed by one array per
+ * component type, so walking a column of a chunk is a linear scan. Tags are part of the signature
+ * but have no column. Rows are kept dense by moving the last row into any row that is removed.
+ */
+class archetype {
+public:
+    using size_type = std::size_t;
+
+    static constexpr size_type null_id = static_cast<size_type>(-1);
+    static constexpr size_type chunk_bytes = 16 * 1024;
+
+    archetype(std::vector<type_guid> sig, std::vector<const column_type*> cols)
+        : signature(std::move(sig)), columns(std::move(cols)) {
+        for (auto guid : signature) {
+            mask.set(guid);
+        }
+
+        auto row_bytes = sizeof(size_type);
+        for (size_type i = 0; i < columns.size(); ++i) {
+            auto guid = columns[i]->guid;
+            if (guid >= column_of.size()) {
+                column_of.resize(guid + 1, null_id);
+            }
+            column_of[guid] = i;
+            row_bytes += columns[i]->size;
+            alignment = std::max(alignment, columns[i]->align);
+        }
+
+        chunk_capacity = std::max(size_type{1}, chunk_bytes / row_bytes);
+        chunk_size = chunk_capacity * sizeof(size_type);
+        for (auto col : columns) {
+            chunk_size = (chunk_size + col->align - 1) / col->align * col->align;
+            offsets.push_back(chunk_size);
+            chunk_size += chunk_capacity * col->size;
+        }
+    }
+
+    archetype(const archetype&) = delete;
+    archetype& operator=(const archetype&) = delete;
+
+    ~archetype() {
+        for (size_type row = 0; row < count; ++row) {
+            destroy(row);
+        }
+        for (auto chunk : chunks) {
+            ::operator delete(chunk, std::align_val_t{alignment});
+        }
+    }
+
+    /*! Appends a row for the entity, the caller constructs its components.
+     */
+    size_type push(size_type entid) {
+        if (count == chunks.size() * chunk_capacity) {
+            chunks.push_back(static_cast<std::byte*>(::operator new(chunk_size, std::align_val_t{alignment})));
+        }
+        auto row = count++;
+        get_entid(row) = entid;
+        return row;
+    }
+
+    /*! Removes a row whose components were already moved out or destroyed.
+     *
+     * @return The entity moved into the row, or null_id if the row was the last one.
+     */
+    size_type pop(size_type row) {
+        auto last = --count;
+        if (row == last) {
+            return null_id;
+        }
+        for (size_type i = 0; i < columns.size(); ++i) {
+            columns[i]->relocate(get(i, row), get(i, last));
+        }
+        auto moved = get_entid(last);
+        get_entid(row) = moved;
+        return moved;
+    }
+
+    void destroy(size_type row) {
+        for (size_type i = 0; i < columns.size(); ++i) {
+            columns[i]->destroy(get(i, row));
+        }
+    }
+
+    void* get(size_type column, size_type row) {
+        return get_column_data(row / chunk_capacity, column) + row % chunk_capacity * columns[column]->size;
+    }
+
+    size_type& get_entid(size_type row) {
+        return get_entids(row / chunk_capacity)[row % chunk_capacity];
+    }
+
+    size_type* get_entids(size_type chunk) {
+        return reinterpret_cast<size_type*>(chunks[chunk]);
+    }
+
+    std::byte* get_column_data(size_type chunk, size_type column) {
+        return column == null_id ? nullptr : chunks[chunk] + offsets[column];
+    }
+
+    size_type get_column(type_guid guid) const {
+        return guid < column_of.size() ? column_of[guid] : null_id;
+    }
+
+    bool has(type_guid guid) const {
+        return mask.get(guid);
+    }
+
+    size_type size() const {
+        return count;
+    }
+
+    /*! Number of chunks that hold at least one row.
+     */
+    size_type chunk_count() const {
+        return (count + chunk_capacity - 1) / chunk_capacity;
+    }
+
+    size_type rows_in_chunk(size_type chunk) const {
+        return std::min(chunk_capacity, count - chunk * chunk_capacity);
+    }
+
+    const std::vector<type_guid>& get_signature() const {
+        return signature;
+    }
+
+    const std::vector<const column_type*>& get_columns() const {
+        return columns;
+    }
+
+    size_type get_edge(type_guid guid, bool add) const {
+        auto& edges = add ? add_edges : remove_edges;
+        return guid < edges.size() ? edges[guid] : null_id;
+    }
+
+    void set_edge(type_guid guid, bool add, size_type target) {
+        auto& edges = add ? add_edges : remove_edges;
+        if (guid >= edges.size()) {
+            edges.resize(guid + 1, null_id);
+        }
+        edges[guid] = target;
+    }
+
+private:
+    std::vector<type_guid> signature;
+    std::vector<const column_type*> columns;
+    dynamic_bitset mask;
+    std::vector<size_type> column_of;
+    std::vector<size_type> offsets;
+    std::vector<std::byte*> chunks;
+    std::vector<size_type> add_edges;
+    std::vector<size_type> remove_edges;
+    size_type chunk_capacity = 0;
+    size_type chunk_size = 0;
+    size_type alignment = alignof(size_type);
+    size_type count = 0;
+};
+
+/*! Archetype Database
+ *
+ * An Entity component Database with the same interface as database, that groups entities
+ * by their set of components. A visit checks each archetype once and then streams through its
+ * chunks, with no per-entity membership tests.
+ *
+ * Adding or removing a component moves all of the entity's components to another archetype,
+ * so database is the better choice when entities change their set of components every frame.
+ *
+ * @warning
+ * References to components are invalidated by any change to the set of components of any entity,
+ * and by destroying entities.
+ *
+ * @warning
+ * This container does not perform any synchronization. Therefore, it is not
+ * considered "thread-safe".
+ */
+class archetype_database {
+public:
+    using size_type = archetype::size_type;
+
+    // IDs
+
+    /*! Entity ID.
+     */
+    class ent_id {
+    public:
+        friend class archetype_database;
+        using index_type = size_type;
+        using version_type = entity::version_type;
+
+        bool operator==(const ent_id& other) const {
+            return index == other.index && version == other.version;
+        }
+
+        index_type get_index() const {
+            return index;
+        }
+
+    private:
+        ent_id(index_type i, version_type v)
+            : index(i), version(v) {}
+
+        index_type index = 0;
+        version_type version = 0;
+    };
+
+    archetype_database() {
+        archetypes.push_back(std::make_unique<archetype>(std::vector<type_guid>{}, std::vector<const column_type*>{}));
+        archetype_lookup.emplace(std::vector<type_guid>{}, 0);
+    }
+
+    /*! Creates a new Entity.
+     *
+     * Creates a new Entity that has no components.
+     *
+     * @return ID of the new Entity.
+     */
+    ent_id create_entity() {
+        ent_id::index_type index;
+
+        if (free_entities.empty()) {
+            index = entities.size();
+            entities.emplace_back();
+        } else {
+            index = free_entities.back();
+            free_entities.pop_back();
+        }
+
+        entities[index].archetype_id = 0;
+        entities[index].row = archetypes[0]->push(index);
+
+        return {index, entities[index].version};
+    }
+
+    /*! Destroys an Entity.
+     *
+     * Destroys the given Entity and all associated components.
+     *
+     * If the Entity does not exist, no work is done.
+     *
+     * @param eid ID of the Entity to erase.
+     */
+    void destroy_entity(const ent_id& eid) {
+        auto& loc = entities[eid.get_index()];
+
+        if (loc.version != eid.version || loc.archetype_id == archetype::null_id) {
+            return;
+        }
+
+        auto& arch = *archetypes[loc.archetype_id];
+        arch.destroy(loc.row);
+        if (auto moved = arch.pop(loc.row); moved != archetype::null_id) {
+            entities[moved].row = loc.row;
+        }
+
+        loc.archetype_id = archetype::null_id;
+        ++loc.version;
+        free_entities.push_back(eid.get_index());
+    }
+
+    /*! Determines whether or not an entity exists.
+     *
+     * @param eid ID of the Entity to check.
+     */
+    bool exists(const ent_id& eid) const {
+        return entities[eid.index].version == eid.version && entities[eid.index].archetype_id != archetype::null_id;
+    }
+
+    /*! Adds a component to an entity.
+     *
+     * If a component of the same type already exists for this entity,
+     * the given component will be forward-assigned to it.
+     *
+     * Otherwise, moves the entity to the archetype that also has the component,
+     * and moves or copies the given component into it.
+     *
+     * @param eid Entity to attach new component to.
+     * @param com Component value.
+     * @return Reference to the component.
+     */
+    template <typename T>
+    std::decay_t<T>& add_component(const ent_id& eid, T&& com) {
+        using com_type = std::decay_t<T>;
+        auto index = eid.get_index();
+        auto guid = get_type_guid<com_type>();
+        auto& loc = entities[index];
+        auto column = archetypes[loc.archetype_id]->get_column(guid);
+
+        if (column != archetype::null_id) {
+            auto& existing = *static_cast<com_type*>(archetypes[loc.archetype_id]->get(column, loc.row));
+            existing = std::forward<T>(com);
+            return existing;
+        }
+
+        move_entity(index, get_neighbour(loc.archetype_id, guid, get_column_type<com_type>(), true));
+        auto& arch = *archetypes[loc.archetype_id];
+        return *new (arch.get(arch.get_column(guid), loc.row)) com_type(std::forward<T>(com));
+    }
+
+    /*! Create new Tag component.
+     *
+     * Adds the tag to the entity if it does not already exist.
+     *
+     * @param eid Entity to attach new Tag component to.
+     * @param com Tag value.
+     */
+    template <typename T>
+    void add_component(ent_id eid, tag<T>) {
+        auto index = eid.get_index();
+        auto guid = get_type_guid<tag<T>>();
+        auto& loc = entities[index];
+
+        if (!archetypes[loc.archetype_id]->has(guid)) {
+            move_entity(index, get_neighbour(loc.archetype_id, guid, nullptr, true));
+        }
+    }
+
+    template <typename T>
+    void add_component(ent_id eid, require<T> com) = delete;
+
+    template <typename T>
+    void add_component(ent_id eid, deny<T> com) = delete;
+
+    template <typename T>
+    void add_component(ent_id eid, optional<T> com) = delete;
+
+    template <typename T>
+    void add_component(ent_id eid, ent_id com) = delete;
+
+    /*! Remove a component from an entity.
+     *
+     * Moves the entity to the archetype without the component and destroys the component.
+     *
+     * If the entity does not exist, or does not have the component, no work is done.
+     *
+     * @tparam Com Type of the component to erase.
+     *
+     * @param eid ID of the entity.
+     */
+    template <typename Com>
+    void remove_component(ent_id eid) {
+        auto index = eid.get_index();
+        auto& loc = entities[index];
+
+        if (loc.version != eid.version || loc.archetype_id == archetype::null_id) {
+            return;
+        }
+
+        auto guid = get_type_guid<Com>();
+
+        if (archetypes[loc.archetype_id]->has(guid)) {
+            move_entity(index, get_neighbour(loc.archetype_id, guid, nullptr, false));
+        }
+    }
+
+    /*! Get a component.
+     *
+     * If Com is a non-pointer type, returns a reference to the component without performing safe checks for existence.
+     *
+     * Otherwise, if Com is a pointer type,
+     * returns a pointer to the component of the pointed-to type that is associated with the given entity.
+     *
+     * If the entity has no associated component of the given type, returns nullptr.
+     *
+     * If the entity does not exist, returns nullptr.
+     *
+     * @tparam Com Type of the component to get.
+     *
+     * @param eid ID of the entity.
+     * @return Either a reference to the component, or a pointer to the component, or nullptr.
+     */
+    template <typename Com>
+    auto get_component(ent_id eid) -> std::conditional_t<std::is_pointer_v<Com>, Com, Com&> {
+        auto& loc = entities[eid.index];
+
+        if constexpr (std::is_pointer_v<Com>) {
+            using component_t = std::remove_pointer_t<Com>;
+
+            if (loc.version != eid.version || loc.archetype_id == archetype::null_id) {
+                return nullptr;
+            }
+
+            auto& arch = *archetypes[loc.archetype_id];
+            auto column = arch.get_column(get_type_guid<component_t>());
+
+            if (column != archetype::null_id) {
+                return static_cast<component_t*>(arch.get(column, loc.row));
+            } else {
+                return nullptr;
+            }
+        } else {
+            auto& arch = *archetypes[loc.archetype_id];
+            return *static_cast<Com*>(arch.get(arch.get_column(get_type_guid<Com>()), loc.row));
+        }
+    }
+
+    /*! Checks if an entity has a component.
+     *
+     * Returns whether or not the entity has a component of the
+     * associated type.
+     *
+     * If the entity does not exist, returns false.
+     *
+     * @tparam Com Type of the component to check.
+     *
+     * @param eid ID of the entity.
+     * @return True if the component exists.
+     */
+    template <typename Com>
+    bool has_component(ent_id eid) const {
+        auto& loc = entities[eid.get_index()];
+
+        if (loc.version != eid.version || loc.archetype_id == archetype::null_id) {
+            return false;
+        }
+
+        return archetypes[loc.archetype_id]->has(get_type_guid<Com>());
+    }
+
+    /*! Visit the Database.
+     *
+     * Accepts the same visitors as database::visit, with the same parameter categories.
+     *
+     * Archetypes that do not match all given parameter conditions are skipped as a whole,
+     * the entities of the others are visited chunk by chunk.
+     *
+     * @warning Creating and destroying entities or adding or removing components
+     *          from within the visitor moves rows around, and could result in weird behavior.
+     *
+     * @tparam Visitor Visitor function type.
+     * @param visitor Visitor function.
+     */
+    template <typename Visitor>
+    void visit(Visitor&& visitor) {
+        using params = typename visitor_params<Visitor>::decayed;
+
+        visit_helper(visitor, params{});
+    }
+
+    /*! Get the number of entities in the Database.
+     *
+     * @return Number of entities in the Database.
+     */
+    auto size() const {
+        return entities.size() - free_entities.size();
+    }
+
+    /*! Get the number of entities that have a component of a certain type.
+     *
+     * @return Number of components of type Com.
+     */
+    template <typename Com>
+    size_type count() const {
+        auto guid = get_type_guid<Com>();
+        size_type total = 0;
+        for (auto& arch : archetypes) {
+            if (arch->has(guid)) {
+                total += arch->size();
+            }
+        }
+        return total;
+    }
+
+    /*! Get the number of archetypes, including the one for entities without components.
+     *
+     * @return Number of archetypes in the Database.
+     */
+    size_type archetype_count() const {
+        return archetypes.size();
+    }
+
+    /*! Converts an ent_id to a void* for storage purposes.
+     *
+     * @see database::to_ptr
+     */
+    auto to_ptr(const ent_id& eid) const -> void* {
+        static_assert(sizeof(void*) >= sizeof(ent_id::index_type), "Pointer conversion not possible");
+        return reinterpret_cast<void*>(eid.get_index());
+    }
+
+    /*! Converts a void* to an ent_id. The pointer must have been returned from to_ptr(eid).
+     *
+     * @see database::from_ptr
+     */
+    auto from_ptr(void* ptr) const -> ent_id {
+        auto i = reinterpret_cast<ent_id::index_type>(ptr);
+        return ent_id{i, entities[i].version};
+    }
+
+private:
+    struct location {
+        size_type archetype_id = archetype::null_id;
+        size_type row = 0;
+        ent_id::version_type version = 0;
+    };
+
+    template <typename Com>
+    using tag_t = typename component_traits<archetype_database, Com>::category;
+
+    template <typename Com>
+    using com_t = typename component_traits<archetype_database, Com>::component;
+
+    // the archetype with the same signature, plus or minus guid
+    size_type get_neighbour(size_type from, type_guid guid, const column_type* type, bool add) {
+        auto target = archetypes[from]->get_edge(guid, add);
+
+        if (target != archetype::null_id) {
+            return target;
+        }
+
+        auto signature = archetypes[from]->get_signature();
+        auto columns = archetypes[from]->get_columns();
+        auto by_guid = [](const column_type* col, type_guid g) { return col->guid < g; };
+
+        if (add) {
+            signature.insert(std::lower_bound(signature.begin(), signature.end(), guid), guid);
+            if (type) {
+                columns.insert(std::lower_bound(columns.begin(), columns.end(), guid, by_guid), type);
+            }
+        } else {
+            signature.erase(std::lower_bound(signature.begin(), signature.end(), guid));
+            auto col = std::lower_bound(columns.begin(), columns.end(), guid, by_guid);
+            if (col != columns.end() && (*col)->guid == guid) {
+                columns.erase(col);
+            }
+        }
+
+        auto [found, inserted] = archetype_lookup.try_emplace(signature, archetypes.size());
+
+        if (inserted) {
+            archetypes.push_back(std::make_unique<archetype>(std::move(signature), std::move(columns)));
+        }
+
+        archetypes[from]->set_edge(guid, add, found->second);
+        return found->second;
+    }
+
+    // moves the components both archetypes have and destroys the rest,
+    // components only the target has are left for the caller to construct
+    void move_entity(size_type index, size_type target) {
+        auto& loc = entities[index];
+        auto& from = *archetypes[loc.archetype_id];
+        auto& to = *archetypes[target];
+        auto row = to.push(index);
+        auto& columns = from.get_columns();
+
+        for (size_type i = 0; i < columns.size(); ++i) {
+            auto column = to.get_column(columns[i]->guid);
+            if (column != archetype::null_id) {
+                columns[i]->relocate(to.get(column, row), from.get(i, loc.row));
+            } else {
+                columns[i]->destroy(from.get(i, loc.row));
+            }
+        }
+
+        if (auto moved = from.pop(loc.row); moved != archetype::null_id) {
+            entities[moved].row = loc.row;
+        }
+
+        loc.archetype_id = target;
+        loc.row = row;
+    }
+
+    template <typename Com>
+    static bool matches(const archetype& arch, component_tags::positive) {
+        return arch.has(get_type_guid<com_t<Com>>());
+    }
+
+    template <typename Com>
+    static bool matches(const archetype& arch, component_tags::inverted) {
+        return !arch.has(get_type_guid<com_t<Com>>());
+    }
+
+    template <typename Com>
+    static bool matches([[maybe_unused]] const archetype& arch, component_tags::meta) {
+        return true;
+    }
+
+    // the column a parameter loads from, null_id when it loads nothing
+    template <typename Com>
+    static size_type get_column(const archetype& arch) {
+        if constexpr (std::is_same_v<tag_t<Com>, component_tags::normal> || std::is_same_v<tag_t<Com>, component_tags::optional>) {
+            return arch.get_column(get_type_guid<com_t<Com>>());
+        } else {
+            return archetype::null_id;
+        }
+    }
+
+    template <typename Com>
+    static bool is_present(const archetype& arch) {
+        if constexpr (std::is_same_v<tag_t<Com>, component_tags::optional>) {
+            return arch.has(get_type_guid<com_t<Com>>());
+        } else {
+            return true;
+        }
+    }
+
+    template <typename Com>
+    Com& get_com(component_tags::normal, std::byte* data, [[maybe_unused]] bool present, [[maybe_unused]] const size_type* entids, size_type row) {
+        return static_cast<Com*>(static_cast<void*>(data))[row];
+    }
+
+    template <typename Com>
+    Com get_com(component_tags::optional, std::byte* data, bool present, [[maybe_unused]] const size_type* entids, size_type row) {
+        using inner_component = com_t<Com>;
+
+        if constexpr (std::is_same_v<tag_t<inner_component>, component_tags::tagged>) {
+            return Com(present);
+        } else {
+            if (data) {
+                return Com(static_cast<inner_component*>(static_cast<void*>(data))[row]);
+            } else {
+                return Com();
+            }
+        }
+    }
+
+    template <typename Com>
+    ent_id get_com(component_tags::eid, [[maybe_unused]] std::byte* data, [[maybe_unused]] bool present, const size_type* entids, size_type row) {
+        return {entids[row], entities[entids[row]].version};
+    }
+
+    template <typename Com>
+    Com get_com(component_tags::unit, [[maybe_unused]] std::byte* data, [[maybe_unused]] bool present, [[maybe_unused]] const size_type* entids, [[maybe_unused]] size_type row) {
+        return {};
+    }
+
+    template <typename Visitor, typename... Coms>
+    void visit_helper(Visitor& visitor, type_list<Coms...>) {
+        visit_helper(visitor, type_list<Coms...>{}, std::index_sequence_for<Coms...>{});
+    }
+
+    template <typename Visitor, typename... Coms, std::size_t... Is>
+    void visit_helper(Visitor& visitor, type_list<Coms...>, std::index_sequence<Is...>) {
+        for (size_type a = 0; a < archetypes.size(); ++a) {
+            auto& arch = *archetypes[a];
+
+            if (arch.size() == 0 || !(matches<Coms>(arch, tag_t<Coms>{}) && ...)) {
+                continue;
+            }
+
+            // the trailing entries keep the arrays from being empty
+            const size_type columns[] = {get_column<Coms>(arch)..., archetype::null_id};
+            const bool present[] = {is_present<Coms>(arch)..., false};
+
+            for (size_type chunk = 0, chunks = arch.chunk_count(); chunk < chunks; ++chunk) {
+                const auto rows = arch.rows_in_chunk(chunk);
+                const auto* entids = arch.get_entids(chunk);
+                std::byte* data[] = {arch.get_column_data(chunk, columns[Is])..., nullptr};
+
+                for (size_type row = 0; row < rows; ++row) {
+                    visitor(get_com<Coms>(tag_t<Coms>{}, data[Is], present[Is], entids, row)...);
+                }
+            }
+        }
+    }
+
+    std::vector<location> entities;
+    std::vector<ent_id::index_type> free_entities;
+    std::vector<std::unique_ptr<archetype>> archetypes;
+    std::map<std::vector<type_guid>, size_type> archetype_lookup;
 };
 
 } // namespace _detail
 
 using _detail::database;
+using _detail::archetype_database;
+using _detail::thread_pool;
+using _detail::default_thread_pool;
 using _detail::require;
 using _detail::optional;
 using _detail::deny;
 using _detail::tag;
+using _detail::query;
+using _detail::component_set_report;
 
 } // namespace Ginseng
@@ -11,4 +11,6 @@ using spdlog::debug;
 using spdlog::error;
 using spdlog::info;
 using spdlog::warn;
+// for messages that cost something to put together, so they are skipped when nobody sees them
+bool debug_enabled() { return spdlog::should_log(spdlog::level::debug); }
 }// namespace logging
@@ -4,6 +4,7 @@ module;
 #include <vector>
 export module rooster;
 export import :logging;
+export import :scheduler;
 export import :time_utils;
 export import ginseng;
 export import centurion;
@@ -39,7 +40,7 @@ private:
   using func_type = std::function<void(ginseng::database &)>;
   hook<func_type, ginseng::database &> m_hook_setup;
   hook<func_type, ginseng::database &> m_hook_end;
-  hook<func_type, ginseng::database &> m_hook_systems;
+  scheduler m_scheduler;
   gameflow m_gameflow;
   ginseng::database m_registry;
   cen::window m_window;
@@ -55,6 +56,22 @@ private:
     m_window.show();
   }
 
+  void log_frame() const
+  {
+    if (!logging::debug_enabled()) { return; }
+    const auto &frame = m_scheduler.last_frame();
+    std::string path;
+    for (const auto system : frame.critical_path) {
+      if (!path.empty()) { path += " -> "; }
+      path += m_scheduler.name(system);
+    }
+    logging::debug("frame {:.2f} ms, systems {:.2f} ms, critical path {:.2f} ms: {}",
+      frame.frame_ms,
+      frame.work_ms,
+      frame.critical_path_ms,
+      path);
+  }
+
 public:
   game(const std::string &title, const cen::iarea window_size)
     : m_window(title, window_size), m_renderer(m_window.make_renderer())
@@ -72,11 +89,24 @@ public:
     m_hook_end.connect(func);
     return *this;
   }
+  // runs alone on the main thread, after the systems added before it and before the ones after it
   game &add_system(func_type func)
   {
-    m_hook_systems.connect(func);
+    m_scheduler.add("system " + std::to_string(m_scheduler.size()), func);
+    return *this;
+  }
+  // runs at the same time as the systems it does not conflict with, see scheduler
+  template<typename... Reads, typename... Writes>
+  game &add_system(std::string name,
+    func_type func,
+    reads<Reads...> read,
+    writes<Writes...> write,
+    system_thread thread = system_thread::any)
+  {
+    m_scheduler.add(std::move(name), func, read, write, thread);
     return *this;
   }
+  const frame_report &last_frame() const { return m_scheduler.last_frame(); }
 
   void run()
   {
@@ -88,7 +118,10 @@ public:
     init_window();
     m_hook_setup.publish(m_registry);
     logging::info("Time for startup {} ms", elapsed(start));
-    while (m_registry.get_component<gameflow>(game_entity) == gameflow::running) { m_hook_systems.publish(m_registry); }
+    while (m_registry.get_component<gameflow>(game_entity) == gameflow::running) {
+      m_scheduler.run(m_registry);
+      log_frame();
+    }
     m_hook_end.publish(m_registry);
     m_window.hide();
   }
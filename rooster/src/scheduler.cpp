@@ -0,0 +1,273 @@
+module;
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <vector>
+export module rooster:scheduler;
+import ginseng;
+
+export namespace rooster {
+
+// the component types a system reads and writes, e.g. add_system("move", move, reads<velocity>{}, writes<position>{})
+template<typename... Components> struct reads
+{
+};
+template<typename... Components> struct writes
+{
+};
+
+enum class system_thread {
+  any,
+  // for systems that talk to SDL, which wants events and rendering on the thread that set it up
+  main
+};
+
+struct frame_report
+{
+  // the whole frame, from the first system starting to the last one finishing
+  double frame_ms = 0;
+  // all the systems added up, what the frame would take if they ran one after another
+  double work_ms = 0;
+  // the longest chain of systems that had to wait for each other, no schedule can beat it
+  double critical_path_ms = 0;
+  // indices of the systems on that chain, first to last
+  std::vector<std::size_t> critical_path;
+  std::vector<double> system_ms;
+};
+
+// Runs the systems of a frame, as many at once as their declared components allow. Two systems
+// conflict when one writes a component the other reads or writes, and conflicting systems run
+// in the order they were added. The dependency graph between them is built once, on the first
+// frame after a system was added. Systems declared without components conflict with everything,
+// which is what a system that creates or destroys entities or adds or removes components needs:
+// the database only allows changes in place while other systems run.
+class scheduler
+{
+public:
+  using func_type = std::function<void(ginseng::database &)>;
+
+  // workers besides the main thread, there are never more than systems that can use them
+  explicit scheduler(std::size_t max_workers = std::max(1u, std::thread::hardware_concurrency()) - 1)
+    : m_max_workers(max_workers)
+  {}
+  scheduler(const scheduler &) = delete;
+  scheduler &operator=(const scheduler &) = delete;
+  ~scheduler() { stop_workers(); }
+
+  // runs alone, on the main thread
+  void add(std::string name, func_type func) { add_entry(std::move(name), std::move(func), {}, {}, false, system_thread::main); }
+
+  template<typename... Reads, typename... Writes>
+  void add(std::string name, func_type func, reads<Reads...>, writes<Writes...>, system_thread thread = system_thread::any)
+  {
+    add_entry(std::move(name), std::move(func), { typeid(Reads)... }, { typeid(Writes)... }, true, thread);
+  }
+
+  // one frame, every system once; returns when all of them are done
+  void run(ginseng::database &db)
+  {
+    if (!m_built) { build(); }
+    if (m_systems.empty()) { return; }
+
+    std::unique_lock lock(m_mutex);
+    m_db = &db;
+    m_frame_start = std::chrono::steady_clock::now();
+    m_remaining = m_systems.size();
+    for (std::size_t i = 0; i < m_systems.size(); ++i) {
+      m_pending[i] = m_systems[i].predecessors.size();
+      if (m_pending[i] == 0) {
+        (m_systems[i].thread == system_thread::main ? m_ready_main : m_ready_any).push_back(i);
+      }
+    }
+    m_wake.notify_all();
+
+    // the main thread takes the systems only it may run first, then helps with the others
+    while (m_remaining > 0) {
+      m_wake.wait(lock, [&] { return m_remaining == 0 || !m_ready_main.empty() || !m_ready_any.empty(); });
+      auto &ready = m_ready_main.empty() ? m_ready_any : m_ready_main;
+      if (ready.empty()) { continue; }
+      const auto i = ready.back();
+      ready.pop_back();
+      execute(i, lock);
+    }
+    m_db = nullptr;
+    lock.unlock();
+    make_report(m_frame_start);
+  }
+
+  const frame_report &last_frame() const { return m_report; }
+  const std::string &name(std::size_t system) const { return m_systems[system].name; }
+  std::size_t size() const { return m_systems.size(); }
+  std::size_t workers() const { return m_workers.size(); }
+
+private:
+  static double ms_since(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  static bool intersect(const std::vector<std::type_index> &a, const std::vector<std::type_index> &b)
+  {
+    return std::any_of(a.begin(), a.end(), [&](const auto &type) { return std::find(b.begin(), b.end(), type) != b.end(); });
+  }
+
+  struct system
+  {
+    std::string name;
+    func_type func;
+    std::vector<std::type_index> reads;
+    std::vector<std::type_index> writes;
+    bool declared;
+    system_thread thread;
+    // edges always point from an earlier system to a later one
+    std::vector<std::size_t> predecessors;
+    std::vector<std::size_t> successors;
+  };
+
+  void add_entry(std::string name,
+    func_type func,
+    std::vector<std::type_index> reads,
+    std::vector<std::type_index> writes,
+    bool declared,
+    system_thread thread)
+  {
+    m_systems.push_back({ std::move(name), std::move(func), std::move(reads), std::move(writes), declared, thread, {}, {} });
+    m_built = false;
+  }
+
+  static bool conflict(const system &a, const system &b)
+  {
+    if (!a.declared || !b.declared) { return true; }
+    return intersect(a.writes, b.reads) || intersect(a.writes, b.writes) || intersect(b.writes, a.reads);
+  }
+
+  void build()
+  {
+    stop_workers();
+    for (auto &s : m_systems) {
+      s.predecessors.clear();
+      s.successors.clear();
+    }
+    for (std::size_t j = 0; j < m_systems.size(); ++j) {
+      for (std::size_t i = 0; i < j; ++i) {
+        if (!conflict(m_systems[i], m_systems[j])) { continue; }
+        m_systems[i].successors.push_back(j);
+        m_systems[j].predecessors.push_back(i);
+      }
+    }
+    m_pending.resize(m_systems.size());
+    m_started_ms.resize(m_systems.size());
+    m_finished_ms.resize(m_systems.size());
+
+    const auto any = static_cast<std::size_t>(std::count_if(
+      m_systems.begin(), m_systems.end(), [](const auto &s) { return s.declared && s.thread == system_thread::any; }));
+    const auto threads = std::min(any, m_max_workers);
+    m_stopping = false;
+    for (std::size_t i = 0; i < threads; ++i) { m_workers.emplace_back([this] { work_loop(); }); }
+    m_built = true;
+  }
+
+  void stop_workers()
+  {
+    {
+      std::lock_guard lock(m_mutex);
+      m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers) { worker.join(); }
+    m_workers.clear();
+  }
+
+  void work_loop()
+  {
+    std::unique_lock lock(m_mutex);
+    while (true) {
+      m_wake.wait(lock, [&] { return m_stopping || !m_ready_any.empty(); });
+      if (m_stopping) { return; }
+      const auto i = m_ready_any.back();
+      m_ready_any.pop_back();
+      execute(i, lock);
+    }
+  }
+
+  // with the lock held: runs system i without it, then releases its successors
+  void execute(std::size_t i, std::unique_lock<std::mutex> &lock)
+  {
+    auto &db = *m_db;
+    lock.unlock();
+    const auto started = ms_since(m_frame_start);
+    m_systems[i].func(db);
+    const auto finished = ms_since(m_frame_start);
+    lock.lock();
+
+    m_started_ms[i] = started;
+    m_finished_ms[i] = finished;
+    for (const auto next : m_systems[i].successors) {
+      if (--m_pending[next] == 0) { (m_systems[next].thread == system_thread::main ? m_ready_main : m_ready_any).push_back(next); }
+    }
+    --m_remaining;
+    m_wake.notify_all();
+  }
+
+  void make_report(std::chrono::steady_clock::time_point start)
+  {
+    const auto n = m_systems.size();
+    auto &report = m_report;
+    report.frame_ms = ms_since(start);
+    report.work_ms = 0;
+    report.system_ms.resize(n);
+    // longest chain ending at each system, the index order is already a topological order
+    std::vector<double> chain(n);
+    std::vector<std::size_t> previous(n);
+    std::size_t last = 0;
+    for (std::size_t j = 0; j < n; ++j) {
+      report.system_ms[j] = m_finished_ms[j] - m_started_ms[j];
+      report.work_ms += report.system_ms[j];
+      previous[j] = j;
+      chain[j] = 0;
+      for (const auto i : m_systems[j].predecessors) {
+        if (chain[i] > chain[j]) {
+          chain[j] = chain[i];
+          previous[j] = i;
+        }
+      }
+      chain[j] += report.system_ms[j];
+      if (chain[j] > chain[last]) { last = j; }
+    }
+    report.critical_path_ms = chain[last];
+    report.critical_path.clear();
+    for (auto i = last;; i = previous[i]) {
+      report.critical_path.push_back(i);
+      if (previous[i] == i) { break; }
+    }
+    std::reverse(report.critical_path.begin(), report.critical_path.end());
+  }
+
+  std::size_t m_max_workers;
+  std::vector<system> m_systems;
+  bool m_built = false;
+  std::vector<std::thread> m_workers;
+
+  // the running frame, all guarded by the mutex
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  ginseng::database *m_db = nullptr;
+  std::vector<std::size_t> m_pending;
+  std::vector<std::size_t> m_ready_any;
+  std::vector<std::size_t> m_ready_main;
+  std::size_t m_remaining = 0;
+  bool m_stopping = false;
+  std::chrono::steady_clock::time_point m_frame_start;
+  std::vector<double> m_started_ms;
+  std::vector<double> m_finished_ms;
+
+  frame_report m_report;
+};
+
+}// namespace rooster